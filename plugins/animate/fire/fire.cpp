@@ -213,6 +213,14 @@ class fire_render_instance_t : public wf::scene::render_instance_t
         }
     }
 
+    void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        for (auto& ch : this->children)
+        {
+            ch->expand_damage(target, damage);
+        }
+    }
+
   private:
     std::vector<wf::scene::render_instance_uptr> children;
 };
@@ -251,6 +259,41 @@ void FireAnimation::init(wayfire_view view, wf::animation_description_t dur, wf:
     auto tr = std::make_shared<fire_node_t>();
     view->get_transformed_node()->add_transformer(
         tr, wf::TRANSFORMER_HIGHLEVEL + 1, name);
+
+    on_quality_change = [=] (bool reduce)
+    {
+        const int new_reduction = reduce ? std::min(particle_reduction + 1, MAX_PARTICLE_REDUCTION) :
+            std::max(particle_reduction - 1, 0);
+        if (new_reduction == particle_reduction)
+        {
+            return false;
+        }
+
+        particle_reduction = new_reduction;
+        return true;
+    };
+
+    on_set_output = [=] (auto)
+    {
+        set_quality_output(this->view->get_output());
+    };
+
+    set_quality_output(view->get_output());
+    view->connect(&on_set_output);
+}
+
+void FireAnimation::set_quality_output(wf::output_t *output)
+{
+    if (quality_output)
+    {
+        quality_output->render->rem_quality_callback(&on_quality_change);
+    }
+
+    quality_output = output;
+    if (quality_output)
+    {
+        quality_output->render->add_quality_callback(&on_quality_change);
+    }
 }
 
 bool FireAnimation::step()
@@ -266,7 +309,7 @@ bool FireAnimation::step()
 
     transformer->ps->update();
     transformer->ps->resize(particle_count_for_width(
-        transformer->get_children_bounding_box().width));
+        transformer->get_children_bounding_box().width) >> particle_reduction);
     return this->progression.running() || transformer->ps->statistic();
 }
 
@@ -277,5 +320,6 @@ void FireAnimation::reverse()
 
 FireAnimation::~FireAnimation()
 {
+    set_quality_output(nullptr);
     view->get_transformed_node()->rem_transformer(name);
 }
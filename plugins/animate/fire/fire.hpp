@@ -3,6 +3,7 @@
 
 #include <wayfire/view-transform.hpp>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
 #include "../animate.hpp"
 
 class FireTransformer;
@@ -14,6 +15,14 @@ class FireAnimation : public wf::animate::animation_base_t
     wayfire_view view;
     wf::animation::simple_animation_t progression;
 
+    // Each step of quality reduction requested by the view's output halves the number of particles.
+    static constexpr int MAX_PARTICLE_REDUCTION = 3;
+    int particle_reduction = 0;
+    wf::output_t *quality_output = nullptr;
+    wf::quality_callback_t on_quality_change;
+    wf::signal::connection_t<wf::view_set_output_signal> on_set_output;
+    void set_quality_output(wf::output_t *output);
+
   public:
 
     ~FireAnimation();
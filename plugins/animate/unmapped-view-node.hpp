@@ -16,6 +16,7 @@ class unmapped_view_snapshot_node : public wf::scene::node_t
   public:
     unmapped_view_snapshot_node(wayfire_view view) : node_t(false)
     {
+        snapshot.set_owner("animate: snapshot of " + view->to_string());
         view->take_snapshot(snapshot);
         snapshot_logical_size = wf::dimensions(view->get_surface_root_node()->get_bounding_box());
         _view = view->weak_from_this();
@@ -7,6 +7,8 @@
 #include <wayfire/output.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <cmath>
 
 static const char *blur_blend_vertex_shader =
     R"(
@@ -59,6 +61,8 @@ void main()
 wf_blur_base::wf_blur_base(std::string name)
 {
     this->algorithm_name = name;
+    this->fb[0].set_owner("blur: " + algorithm_name + " buffers");
+    this->fb[1].set_owner("blur: " + algorithm_name + " buffers");
 
     this->saturation_opt.load_option("blur/saturation");
     this->offset_opt.load_option("blur/" + algorithm_name + "_offset");
@@ -92,7 +96,27 @@ wf_blur_base::~wf_blur_base()
 
 int wf_blur_base::calculate_blur_radius()
 {
-    return offset_opt * degrade_opt * std::max(1, (int)iterations_opt);
+    return offset_opt * degrade_opt * get_iterations();
+}
+
+int wf_blur_base::get_iterations() const
+{
+    return std::max(1, (int)iterations_opt - quality_reduction);
+}
+
+void wf_blur_base::set_quality_reduction(int reduction)
+{
+    reduction = std::clamp(reduction, 0, get_max_quality_reduction());
+    if (reduction != quality_reduction)
+    {
+        quality_reduction = reduction;
+        options_changed();
+    }
+}
+
+int wf_blur_base::get_max_quality_reduction() const
+{
+    return std::max(0, (int)iterations_opt - 1);
 }
 
 void wf_blur_base::render_iteration(wf::region_t blur_region,
@@ -150,6 +174,12 @@ static wf::geometry_t sanitize(wf::geometry_t box, int degrade,
     return wf::clamp(out_box, bounds);
 }
 
+/** @return Largest integer <= x which is divisible by mod, also for negative x */
+static int round_down(int x, int mod)
+{
+    return mod * int(std::floor(1.0 * x / mod));
+}
+
 wlr_box wf_blur_base::copy_region(wf::auxilliary_buffer_t& result,
     const wf::render_target_t& source, const wf::region_t& region)
 {
@@ -161,22 +191,45 @@ wlr_box wf_blur_base::copy_region(wf::auxilliary_buffer_t& result,
 
     // Make sure that the box is aligned properly for degrading, otherwise,
     // we get a flickering
-    subbox = sanitize(subbox, degrade_opt, source_box);
-    int degraded_width  = subbox.width / degrade_opt;
-    int degraded_height = subbox.height / degrade_opt;
+    const int degrade = degrade_opt;
+    subbox = sanitize(subbox, degrade, source_box);
+    int degraded_width  = subbox.width / degrade;
+    int degraded_height = subbox.height / degrade;
     result.allocate({degraded_width, degraded_height});
 
+    // Copy only the tiles which are within the blur radius of the damage.
+    // Damaged rectangles far apart from each other then do not cause the
+    // whole area between them to be copied and blurred.
+    const int tile   = BLUR_TILE_SIZE * degrade;
+    const int radius = calculate_blur_radius();
+    wf::region_t tiles;
+    for (const auto& b : source.framebuffer_region_from_geometry_region(region))
+    {
+        const int x1 = subbox.x + round_down(b.x1 - radius - subbox.x, tile);
+        const int y1 = subbox.y + round_down(b.y1 - radius - subbox.y, tile);
+        const int x2 = subbox.x + round_down(b.x2 + radius - subbox.x + tile - 1, tile);
+        const int y2 = subbox.y + round_down(b.y2 + radius - subbox.y + tile - 1, tile);
+        tiles |= wf::geometry_t{x1, y1, x2 - x1, y2 - y1};
+    }
+
+    tiles &= subbox;
+
     GLuint src_fb = wf::gles::ensure_render_buffer_fb_id(source);
     GLuint dst_fb = wf::gles::ensure_render_buffer_fb_id(result.get_renderbuffer());
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, src_fb));
     GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dst_fb));
 
-    GL_CALL(glBlitFramebuffer(
-        subbox.x, subbox.y,
-        subbox.x + subbox.width, subbox.y + subbox.height,
-        0, 0, degraded_width, degraded_height,
-        GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    for (const auto& b : tiles)
+    {
+        GL_CALL(glBlitFramebuffer(
+            b.x1, b.y1, b.x2, b.y2,
+            (b.x1 - subbox.x) / degrade, (b.y1 - subbox.y) / degrade,
+            (b.x2 - subbox.x) / degrade, (b.y2 - subbox.y) / degrade,
+            GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    }
 
+    copied_region  = tiles + -wf::point_t{subbox.x, subbox.y};
+    copied_region *= 1.0 / degrade;
     return subbox;
 }
 
@@ -187,6 +240,7 @@ void wf_blur_base::prepare_blur(const wf::render_target_t& target_fb, const wf::
         return;
     }
 
+    ++prepare_serial;
     int degrade     = degrade_opt;
     auto damage_box = copy_region(fb[0], target_fb, damage);
 
@@ -223,7 +277,70 @@ static wf::pointf_t get_center(wf::geometry_t g)
 void wf_blur_base::render(wf::gles_texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
     const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb)
 {
-    wf::gles_texture_t blurred_background = wf::gles_texture_t::from_aux(fb[0]);
+    render_with_background(wf::gles_texture_t::from_aux(fb[0]).tex_id, prepared_geometry,
+        src_tex, src_box, damage, background_source_fb, target_fb);
+}
+
+void wf_blur_base::store_backdrop(blurred_backdrop_t& backdrop, const wf::render_target_t& target_fb,
+    wlr_box view_box, const wf::region_t& region)
+{
+    const int degrade = degrade_opt;
+    auto source_box   = target_fb.framebuffer_box_from_geometry_box(target_fb.geometry);
+    auto box = sanitize(target_fb.framebuffer_box_from_geometry_box(view_box), degrade, source_box);
+    const wf::dimensions_t size = {std::max(1, box.width / degrade), std::max(1, box.height / degrade)};
+    if ((box != backdrop.box) || (backdrop.buffer.get_size() != size))
+    {
+        backdrop.box = box;
+        backdrop.valid.clear();
+        backdrop.buffer.allocate(size);
+    }
+
+    GLuint src_fb = wf::gles::ensure_render_buffer_fb_id(fb[0].get_renderbuffer());
+    GLuint dst_fb = wf::gles::ensure_render_buffer_fb_id(backdrop.buffer.get_renderbuffer());
+    GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, src_fb));
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dst_fb));
+
+    // Both buffers are aligned to the degrade grid, so the pixels can be copied one to one.
+    auto to_degraded = [&] (int value, int origin, bool round_up)
+    {
+        return (value - origin + (round_up ? degrade - 1 : 0)) / degrade;
+    };
+
+    for (const auto& b : target_fb.framebuffer_region_from_geometry_region(region))
+    {
+        auto fb_box = wf::geometry_intersection(
+            wf::geometry_intersection(wlr_box_from_pixman_box(b), box), prepared_geometry);
+        if ((fb_box.width <= 0) || (fb_box.height <= 0))
+        {
+            continue;
+        }
+
+        GL_CALL(glBlitFramebuffer(
+            to_degraded(fb_box.x, prepared_geometry.x, false),
+            to_degraded(fb_box.y, prepared_geometry.y, false),
+            to_degraded(fb_box.x + fb_box.width, prepared_geometry.x, true),
+            to_degraded(fb_box.y + fb_box.height, prepared_geometry.y, true),
+            to_degraded(fb_box.x, box.x, false),
+            to_degraded(fb_box.y, box.y, false),
+            to_degraded(fb_box.x + fb_box.width, box.x, true),
+            to_degraded(fb_box.y + fb_box.height, box.y, true),
+            GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    }
+
+    backdrop.valid |= region;
+}
+
+void wf_blur_base::render_backdrop(blurred_backdrop_t& backdrop, wf::gles_texture_t src_tex,
+    wlr_box src_box, const wf::region_t& damage, const wf::render_target_t& target_fb)
+{
+    render_with_background(wf::gles_texture_t::from_aux(backdrop.buffer).tex_id, backdrop.box,
+        src_tex, src_box, damage, target_fb, target_fb);
+}
+
+void wf_blur_base::render_with_background(GLuint background, wlr_box background_box,
+    wf::gles_texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
+    const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb)
+{
     wf::gles::ensure_render_buffer_fb_id(target_fb);
     blend_program.use(src_tex.type);
 
@@ -256,8 +373,8 @@ void wf_blur_base::render(wf::gles_texture_t src_tex, wlr_box src_box, const wf:
     // 3. Scale to match the view size
     // 4. Translate to match the view
     auto view_box    = background_source_fb.framebuffer_box_from_geometry_box(src_box); // Projected view
-    auto blurred_box = prepared_geometry;
-    // prepared_geometry is the projected damage bounding box
+    auto blurred_box = background_box;
+    // background_box is the projected damage bounding box
 
     glm::mat4 fb_fix   = wf::gles::output_transform(target_fb);
     const auto scale_x = 1.0 * view_box.width / blurred_box.width;
@@ -280,7 +397,7 @@ void wf_blur_base::render(wf::gles_texture_t src_tex, wlr_box src_box, const wf:
 
     blend_program.set_active_texture(src_tex);
     GL_CALL(glActiveTexture(GL_TEXTURE0 + 1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, blurred_background.tex_id));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, background));
 
     /* Render it to target_fb */
     wf::gles::bind_render_buffer(target_fb);
@@ -11,6 +11,7 @@
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/bindings-repository.hpp>
+#include <wayfire/render-manager.hpp>
 
 #include "blur.hpp"
 #include "wayfire/core.hpp"
@@ -21,11 +22,18 @@
 #include "wayfire/scene-render.hpp"
 #include "wayfire/scene.hpp"
 #include "wayfire/signal-provider.hpp"
+#include <algorithm>
+#include <array>
 #include <list>
+#include <tuple>
 
 using blur_algorithm_provider =
     std::function<nonstd::observer_ptr<wf_blur_base>()>;
 
+// Reusing the blurred background needs a buffer per view and a connection to every node below it, so it is
+// opt-in.
+static wf::option_wrapper_t<bool> reuse_backdrop{"blur/reuse_backdrop"};
+
 static int calculate_damage_padding(const wf::render_target_t& target, int blur_radius)
 {
     float scale = target.scale;
@@ -80,6 +88,7 @@ class blur_node_t : public transformer_base_node_t
         }
 
         saved_pixels.emplace_back();
+        saved_pixels.back().pixels.set_owner("blur: saved pixels");
         saved_pixels.back().taken = true;
         return &saved_pixels.back();
     }
@@ -90,9 +99,259 @@ class blur_node_t : public transformer_base_node_t
     }
 };
 
+/**
+ * Blurred views which are rendered one after another in a render pass, with
+ * nothing in between that changes the background of the views in front. The
+ * backgrounds of all views in the batch are blurred together, when the first
+ * of them is rendered.
+ */
+struct blur_batch_t
+{
+    // The instruction list of the render pass, and the instruction of the
+    // rearmost view in the batch so far.
+    std::vector<render_instruction_t> *instructions = nullptr;
+    size_t last_index = 0;
+    render_instance_t *last_instance = nullptr;
+    wlr_buffer *target_buffer = nullptr;
+
+    // The parts of the background which the views sample from, and which
+    // they blur.
+    wf::region_t sampled;
+    wf::region_t damage;
+
+    // Whether the background has been blurred, and the serial of the
+    // algorithm's prepare_blur() call which did it.
+    bool prepared = false;
+    uint64_t prepare_serial = 0;
+};
+
+// The batches of the render passes which are currently being scheduled.
+// Render passes can be nested, so there may be more than one.
+static std::vector<std::weak_ptr<blur_batch_t>> scheduled_batches;
+
 class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
 {
     blur_node_t::saved_pixels_t *saved_pixels = nullptr;
+    std::shared_ptr<blur_batch_t> batch;
+
+    // The blurred background of the view from the previous frames, and the
+    // render target geometry, scale, transform, subbuffer, size and blur
+    // radius it was blurred for.
+    blurred_backdrop_t backdrop;
+    using backdrop_key_t = std::tuple<wf::geometry_t, float, wl_output_transform,
+        std::optional<wf::geometry_t>, int, int, int>;
+    backdrop_key_t backdrop_key;
+
+    // Damage caused by the view itself during the last frames, the current
+    // frame first. A render pass may repaint the damage of several frames,
+    // depending on the age of the buffer, so a few frames are kept.
+    std::array<wf::region_t, 3> own_damage;
+
+    // Whether the nodes stacked below the view were damaged or restacked
+    // during the last frames, in the same order as own_damage. The nodes
+    // report damage in their own coordinate systems, so only whether anything
+    // below changed is tracked, not where.
+    std::array<bool, 3> below_damaged = {true, true, true};
+    bool below_nodes_dirty = true;
+
+    wf::signal::connection_t<wf::scene::node_damage_signal> on_below_damage = [=] (auto)
+    {
+        below_damaged[0] = true;
+    };
+
+    wf::signal::connection_t<wf::scene::root_node_update_signal> on_root_update =
+        [=] (wf::scene::root_node_update_signal *ev)
+    {
+        if (ev->flags & (wf::scene::update_flag::CHILDREN_LIST | wf::scene::update_flag::ENABLED))
+        {
+            below_nodes_dirty = true;
+            below_damaged[0]  = true;
+        }
+    };
+
+    // Whether the current instruction renders the stored backdrop instead of
+    // blurring the background again, and otherwise, the region which is
+    // blurred and afterwards stored in the backdrop.
+    bool use_backdrop = false;
+    wf::region_t blurred_region;
+
+  protected:
+    void transform_damage_region(wf::region_t& damage) override
+    {
+        own_damage[0] |= damage;
+    }
+
+    /**
+     * Find the damage around the view which may have changed its background.
+     */
+    wf::region_t calculate_background_damage(const wf::region_t& damage, wf::geometry_t bbox, int padding)
+    {
+        wf::region_t around = bbox;
+        around.expand_edges(padding);
+        around &= damage;
+        if (!reuse_backdrop)
+        {
+            return around;
+        }
+
+        if (std::find(below_damaged.begin(), below_damaged.end(), true) != below_damaged.end())
+        {
+            return around;
+        }
+
+        // Damage of the view itself does not change its background. Nothing
+        // below the view was damaged, so damage around the view which is not
+        // the view's own comes from somewhere else, for example directly from
+        // the output.
+        wf::region_t own;
+        for (const auto& frame : own_damage)
+        {
+            own |= frame;
+        }
+
+        own &= bbox;
+        return around ^ own;
+    }
+
+    /**
+     * Listen for damage on all enabled nodes which are stacked below the view
+     * on its output.
+     */
+    void connect_below_nodes()
+    {
+        below_nodes_dirty = false;
+        on_below_damage.disconnect();
+
+        wf::scene::node_t *node = self.get();
+        for (auto parent = node->parent(); parent; node = parent, parent = parent->parent())
+        {
+            auto& siblings = parent->get_children();
+            auto it = std::find_if(siblings.begin(), siblings.end(), [&] (const wf::scene::node_ptr& sibling)
+            {
+                return sibling.get() == node;
+            });
+            if (it == siblings.end())
+            {
+                continue;
+            }
+
+            // Children are sorted from the topmost to the bottom-most.
+            for (++it; it != siblings.end(); ++it)
+            {
+                connect_subtree(*it);
+            }
+        }
+    }
+
+    void connect_subtree(const wf::scene::node_ptr& node)
+    {
+        if (!node->is_enabled())
+        {
+            return;
+        }
+
+        auto output_node = dynamic_cast<wf::scene::output_node_t*>(node.get());
+        if (output_node && (output_node->get_output() != _shown_on))
+        {
+            return;
+        }
+
+        node->connect(&on_below_damage);
+        for (auto& ch : node->get_children())
+        {
+            connect_subtree(ch);
+        }
+    }
+
+    void update_backdrop_key(const wf::render_target_t& target, int radius)
+    {
+        const auto size = target.get_size();
+        backdrop_key_t key{target.geometry, target.scale, target.wl_transform, target.subbuffer,
+            size.width, size.height, radius};
+        if (key != backdrop_key)
+        {
+            backdrop_key = key;
+            backdrop.valid.clear();
+        }
+    }
+
+    /**
+     * Add the view to the batch of the view in front of it, if nothing which
+     * is rendered between them changes the background of the views in front,
+     * or start a new batch.
+     */
+    void join_batch(std::vector<render_instruction_t>& instructions, const wf::render_target_t& target,
+        const wf::region_t& repaint, int padding)
+    {
+        wf::region_t sampled = repaint;
+        sampled.expand_edges(padding);
+        wf::region_t translucent = calculate_translucent_damage(target, repaint);
+
+        auto it = std::find_if(scheduled_batches.begin(), scheduled_batches.end(), [&] (const auto& weak)
+        {
+            auto candidate = weak.lock();
+            return candidate && (candidate->instructions == &instructions) &&
+                   (candidate->target_buffer == target.get_buffer()) &&
+                   (candidate->last_index < instructions.size()) &&
+                   (instructions[candidate->last_index].instance == candidate->last_instance);
+        });
+
+        batch = (it != scheduled_batches.end()) ? it->lock() : nullptr;
+        if (batch)
+        {
+            wf::region_t drawn = repaint;
+            for (size_t i = batch->last_index + 1; i < instructions.size(); i++)
+            {
+                drawn |= instructions[i].damage;
+            }
+
+            if (!(drawn & batch->sampled).empty())
+            {
+                batch = nullptr;
+            }
+        }
+
+        if (!batch)
+        {
+            batch = std::make_shared<blur_batch_t>();
+            batch->instructions  = &instructions;
+            batch->target_buffer = target.get_buffer();
+            scheduled_batches.erase(std::remove_if(scheduled_batches.begin(), scheduled_batches.end(),
+                [&] (const auto& weak)
+            {
+                auto other = weak.lock();
+                return !other || (other->instructions == &instructions);
+            }), scheduled_batches.end());
+            scheduled_batches.push_back(batch);
+        }
+
+        batch->sampled |= sampled;
+        batch->damage  |= translucent;
+        batch->last_index    = instructions.size();
+        batch->last_instance = this;
+    }
+
+    void prepare_background(const wf::render_target_t& target, const wf::region_t& translucent_damage)
+    {
+        auto provider = self->provider();
+        if (batch && batch->prepared && (batch->prepare_serial == provider->get_prepare_serial()))
+        {
+            // Already blurred together with a view behind this one.
+            return;
+        }
+
+        if (batch && !batch->prepared)
+        {
+            provider->prepare_blur(target, batch->damage);
+            batch->prepared = true;
+            batch->prepare_serial = provider->get_prepare_serial();
+            return;
+        }
+
+        // The shared background was overwritten, for example by a nested
+        // render pass, so blur the background of this view alone.
+        provider->prepare_blur(target, translucent_damage);
+    }
 
   public:
     using transformer_render_instance_t::transformer_render_instance_t;
@@ -128,12 +387,81 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         return damage;
     }
 
+    void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        // Pixels which changed within the blur radius around the view change
+        // the blurred background of the view as well, so the affected parts of
+        // the view have to be repainted. Damage far away from the view does not
+        // affect it, so only the area around the view is considered.
+        const int padding = calculate_damage_padding(target, self->provider()->calculate_blur_radius());
+        auto bbox = self->get_bounding_box();
+
+        wf::region_t affected = calculate_background_damage(damage, bbox, padding);
+        if (affected.empty())
+        {
+            return;
+        }
+
+        affected.expand_edges(padding);
+        affected &= bbox;
+        affected &= target.geometry;
+        if (!is_fully_opaque(affected))
+        {
+            damage |= affected;
+        }
+    }
+
     void schedule_instructions(std::vector<render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
     {
-        const int padding = calculate_damage_padding(target, self->provider()->calculate_blur_radius());
+        const int radius  = self->provider()->calculate_blur_radius();
+        const int padding = calculate_damage_padding(target, radius);
         auto bbox = self->get_bounding_box();
 
+        // Forget the parts of the backdrop whose background may have changed.
+        update_backdrop_key(target, radius);
+        if (!reuse_backdrop)
+        {
+            backdrop.valid.clear();
+            on_root_update.disconnect();
+            on_below_damage.disconnect();
+            below_nodes_dirty = true;
+        } else
+        {
+            if (!on_root_update.is_connected())
+            {
+                wf::get_core().scene()->connect(&on_root_update);
+                below_damaged[0] = true;
+            }
+
+            if (below_nodes_dirty)
+            {
+                connect_below_nodes();
+            }
+        }
+
+        wf::region_t background_damage = calculate_background_damage(damage, bbox, padding);
+        if (!background_damage.empty())
+        {
+            background_damage.expand_edges(padding);
+            backdrop.valid ^= background_damage;
+        }
+
+        // The instruction of the previous pass may have been dropped because
+        // it was hidden, so render() did not release the saved pixels.
+        if (saved_pixels)
+        {
+            saved_pixels->region.clear();
+            self->release_saved_pixel_buffer(saved_pixels);
+            saved_pixels = nullptr;
+        }
+
+        std::move_backward(own_damage.begin(), own_damage.end() - 1, own_damage.end());
+        own_damage[0].clear();
+        std::move_backward(below_damaged.begin(), below_damaged.end() - 1, below_damaged.end());
+        below_damaged[0] = false;
+        batch = nullptr;
+
         // In order to render a part of the blurred background, we need to sample
         // from area which is larger than the damaged area. However, the edges
         // of the expanded area suffer from the same problem (e.g. the blurred
@@ -155,6 +483,24 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
             return;
         }
 
+        // If the background did not change, the blurred background of the
+        // previous frames can be used as it is, and there is no need to
+        // render the nodes below with padding and to blur again.
+        wf::region_t visible_damage = padded_region & target.geometry;
+        if (!backdrop.valid.empty() &&
+            (calculate_translucent_damage(target, visible_damage) ^ backdrop.valid).empty())
+        {
+            use_backdrop = true;
+            instructions.push_back(render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = visible_damage,
+                    });
+            return;
+        }
+
+        use_backdrop   = false;
+        blurred_region = visible_damage;
         padded_region.expand_edges(padding);
         padded_region &= bbox;
 
@@ -195,6 +541,7 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
             }
         });
 
+        join_batch(instructions, target, we_repaint, padding);
         instructions.push_back(render_instruction_t{
                     .instance = this,
                     .target   = target,
@@ -208,10 +555,23 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         data.pass->custom_gles_subpass([&]
         {
             auto tex = wf::gles_texture_t{get_texture(data.target.scale)};
+            if (use_backdrop)
+            {
+                self->provider()->render_backdrop(backdrop, tex, bounding_box, data.damage, data.target);
+                return;
+            }
+
             if (!data.damage.empty())
             {
                 auto translucent_damage = calculate_translucent_damage(data.target, data.damage);
-                self->provider()->prepare_blur(data.target, translucent_damage);
+                prepare_background(data.target, translucent_damage);
+                if (reuse_backdrop)
+                {
+                    // The padding around the damage is blurred from pixels of the previous frame, so only
+                    // the damage itself is blurred correctly and can be kept.
+                    self->provider()->store_backdrop(backdrop, data.target, bounding_box,
+                        translucent_damage & blurred_region);
+                }
                 self->provider()->render(tex, bounding_box, data.damage, data.target, data.target);
             }
 
@@ -240,6 +600,7 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
             saved_pixels->region.clear();
             self->release_saved_pixel_buffer(saved_pixels);
             saved_pixels = NULL;
+            batch = nullptr;
         });
     }
 
@@ -263,26 +624,44 @@ void blur_node_t::gen_render_instances(std::vector<render_instance_uptr>& instan
 }
 }
 
-class wayfire_blur : public wf::plugin_interface_t
+/**
+ * Tracks how much an output asks blur to reduce its quality to stay within the frame budget.
+ */
+class blur_output_quality_t : public wf::per_output_plugin_instance_t
 {
-    // Before doing a render pass, expand the damage by the blur radius.
-    // This is needed, because when blurring, the pixels that changed
-    // affect a larger area than the really damaged region, e.g. the region
-    // that comes from client damage.
-    wf::signal::connection_t<wf::render_pass_begin_signal>
-    on_render_pass_begin = [=] (wf::render_pass_begin_signal *ev)
+  public:
+    int reduction = 0;
+    std::function<int()> get_max_reduction;
+    std::function<void()> reduction_changed;
+
+    wf::quality_callback_t on_quality_change = [=] (bool reduce)
     {
-        if (!provider)
+        const int new_reduction = reduce ? std::min(reduction + 1, get_max_reduction()) :
+            std::max(reduction - 1, 0);
+        if (new_reduction == reduction)
         {
-            return;
+            return false;
         }
 
-        const int padding =
-            calculate_damage_padding(ev->pass.get_target(), provider()->calculate_blur_radius());
-        ev->damage.expand_edges(padding);
-        ev->damage &= ev->pass.get_target().geometry;
+        reduction = new_reduction;
+        reduction_changed();
+        return true;
     };
 
+    void init() override
+    {
+        output->render->add_quality_callback(&on_quality_change);
+    }
+
+    void fini() override
+    {
+        output->render->rem_quality_callback(&on_quality_change);
+    }
+};
+
+class wayfire_blur : public wf::plugin_interface_t,
+    public wf::per_output_tracker_mixin_t<blur_output_quality_t>
+{
   public:
     blur_algorithm_provider provider;
     wf::button_callback button_toggle;
@@ -300,6 +679,42 @@ class wayfire_blur : public wf::plugin_interface_t
     wf::config::option_base_t::updated_callback_t blur_method_changed;
     std::unique_ptr<wf_blur_base> blur_algorithm;
 
+    void handle_new_output(wf::output_t *output) override
+    {
+        auto inst = std::make_unique<blur_output_quality_t>();
+        inst->output = output;
+        inst->get_max_reduction = [=] ()
+        {
+            return blur_algorithm ? blur_algorithm->get_max_quality_reduction() : 0;
+        };
+        inst->reduction_changed = [=] () { update_quality(); };
+        inst->init();
+        output_instance[output] = std::move(inst);
+    }
+
+    void handle_output_removed(wf::output_t *output) override
+    {
+        wf::per_output_tracker_mixin_t<blur_output_quality_t>::handle_output_removed(output);
+        update_quality();
+    }
+
+    /**
+     * The blur algorithm is shared by all outputs, so it runs at the quality of the most loaded output.
+     */
+    void update_quality()
+    {
+        int reduction = 0;
+        for (auto& [output, inst] : output_instance)
+        {
+            reduction = std::max(reduction, inst->reduction);
+        }
+
+        if (blur_algorithm)
+        {
+            blur_algorithm->set_quality_reduction(reduction);
+        }
+    }
+
     void add_transformer(wayfire_view view)
     {
         auto tmanager = view->get_transformed_node();
@@ -342,16 +757,17 @@ class wayfire_blur : public wf::plugin_interface_t
             return;
         }
 
-        wf::get_core().connect(&on_render_pass_begin);
         blur_method_changed = [=] ()
         {
             blur_algorithm = create_blur_from_name(method_opt);
+            update_quality();
             wf::scene::damage_node(wf::get_core().scene(), wf::get_core().scene()->get_bounding_box());
         };
 
         /* Create initial blur algorithm */
         blur_method_changed();
         method_opt.set_callback(blur_method_changed);
+        init_output_tracking();
 
         /* Toggles the blur state of the view the user clicked on */
         button_toggle = [=] (auto)
@@ -390,6 +806,7 @@ class wayfire_blur : public wf::plugin_interface_t
     {
         remove_transformers();
         wf::get_core().bindings->rem_binding(&button_toggle);
+        fini_output_tracking();
 
         /* Call blur algorithm destructor */
         blur_algorithm = nullptr;
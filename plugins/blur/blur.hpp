@@ -88,6 +88,23 @@
  * `````````````````````````````````````````````````````````````````
  */
 
+/**
+ * A blurred background which is kept between frames, so that it does not need
+ * to be blurred again when only the view in front of it changes.
+ */
+struct blurred_backdrop_t
+{
+    /* The blurred background, degraded like the buffers of the algorithm */
+    wf::auxilliary_buffer_t buffer;
+    /* The area covered by the buffer, in framebuffer coordinates */
+    wf::geometry_t box = {0, 0, 0, 0};
+    /* The parts of the buffer which are up to date, in logical coordinates */
+    wf::region_t valid;
+};
+
+/* The size of the tiles copied by wf_blur_base::copy_region(), in degraded pixels */
+static constexpr int BLUR_TILE_SIZE = 32;
+
 class wf_blur_base
 {
   protected:
@@ -95,6 +112,9 @@ class wf_blur_base
      * destructor */
     wf::auxilliary_buffer_t fb[2];
     wf::geometry_t prepared_geometry;
+    /* the parts of fb[0] which contain pixels copied by copy_region, in
+     * degraded buffer coords. Pixels outside of it are undefined. */
+    wf::region_t copied_region;
 
     /* the program created by the given algorithm, cleaned up in base destructor */
     OpenGL::program_t program[2];
@@ -111,14 +131,23 @@ class wf_blur_base
     wf::option_wrapper_t<int> degrade_opt, iterations_opt;
     wf::config::option_base_t::updated_callback_t options_changed;
 
+    /* incremented by every prepare_blur() call */
+    uint64_t prepare_serial = 0;
+
+    /* number of iterations skipped because rendering is over the frame budget */
+    int quality_reduction = 0;
+
+    /* the number of iterations to actually run, at least 1 */
+    int get_iterations() const;
+
     /* renders the in texture to the out framebuffer.
      * assumes a properly bound and initialized GL program */
     void render_iteration(wf::region_t blur_region,
         wf::auxilliary_buffer_t& in, wf::auxilliary_buffer_t& out,
         int width, int height);
 
-    /* copy the source pixels from region, storing into result
-     * returns the result geometry, in framebuffer coords */
+    /* copy the source pixels within the blur radius of region, storing into
+     * result. returns the result geometry, in framebuffer coords */
     wlr_box copy_region(wf::auxilliary_buffer_t& result,
         const wf::render_target_t& source, const wf::region_t& region);
 
@@ -127,12 +156,29 @@ class wf_blur_base
      * returns the index of the fb where the result is stored (0 or 1) */
     virtual int blur_fb0(const wf::region_t& blur_region, int width, int height) = 0;
 
+    /* blend the view texture with the blurred background in @background, which
+     * covers @background_box in framebuffer coords */
+    void render_with_background(GLuint background, wlr_box background_box,
+        wf::gles_texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
+        const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb);
+
   public:
     wf_blur_base(std::string name);
     virtual ~wf_blur_base();
 
     virtual int calculate_blur_radius();
 
+    /**
+     * Reduce the number of blur iterations by @reduction, to lower the cost of blurring when the output
+     * is over its frame budget.
+     */
+    void set_quality_reduction(int reduction);
+
+    /**
+     * @return The largest useful argument for set_quality_reduction().
+     */
+    int get_max_quality_reduction() const;
+
     /**
      * Calculate the blurred background region.
      *
@@ -141,6 +187,15 @@ class wf_blur_base
      */
     void prepare_blur(const wf::render_target_t& target_fb, const wf::region_t& damage);
 
+    /**
+     * @return A number which changes whenever @prepare_blur is called, so that
+     *   users can check whether the prepared background is still theirs.
+     */
+    uint64_t get_prepare_serial() const
+    {
+        return prepare_serial;
+    }
+
     /**
      * Render a view with a blended background as prepared from @prepare_blur.
      *
@@ -152,6 +207,25 @@ class wf_blur_base
      */
     void render(wf::gles_texture_t src_tex, wlr_box src_box, const wf::region_t& damage,
         const wf::render_target_t& background_source_fb, const wf::render_target_t& target_fb);
+
+    /**
+     * Copy the parts of the background prepared by @prepare_blur which are in
+     * @region to @backdrop, and mark them as valid.
+     *
+     * @param target_fb The render target which was passed to @prepare_blur.
+     * @param view_box The geometry of the view, in logical coordinates. If the
+     *   view moved or the degrade option changed, @backdrop is cleared first.
+     * @param region The region to copy, in logical coordinates.
+     */
+    void store_backdrop(blurred_backdrop_t& backdrop, const wf::render_target_t& target_fb,
+        wlr_box view_box, const wf::region_t& region);
+
+    /**
+     * Same as @render, but use a blurred background stored with @store_backdrop
+     * instead of the one prepared by @prepare_blur.
+     */
+    void render_backdrop(blurred_backdrop_t& backdrop, wf::gles_texture_t src_tex, wlr_box src_box,
+        const wf::region_t& damage, const wf::render_target_t& target_fb);
 };
 
 std::unique_ptr<wf_blur_base> create_box_blur();
@@ -68,7 +68,7 @@ class wf_bokeh_blur : public wf_blur_base
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
-        int iterations = iterations_opt;
+        int iterations = get_iterations();
         float offset   = offset_opt;
 
         static const float vertexData[] = {
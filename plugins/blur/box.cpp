@@ -105,7 +105,7 @@ class wf_box_blur : public wf_blur_base
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
-        int i, iterations = iterations_opt;
+        int i, iterations = get_iterations();
         GL_CALL(glDisable(GL_BLEND));
         /* Enable our shader and pass some data to it. The shader
          * does box blur on the background texture in two passes,
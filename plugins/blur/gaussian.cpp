@@ -105,7 +105,7 @@ class wf_gaussian_blur : public wf_blur_base
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
-        int i, iterations = iterations_opt;
+        int i, iterations = get_iterations();
 
         wf::gles::run_in_context_if_gles([&]
         {
@@ -1,4 +1,5 @@
 #include "blur.hpp"
+#include <vector>
 
 static const char *kawase_vertex_shader =
     R"(
@@ -57,8 +58,22 @@ void main()
     gl_FragColor = sum / 12.0;
 })";
 
+/**
+ * Dual filter (Kawase) blur: the background is downsampled to a pyramid of
+ * half-sized levels and upsampled back, which gives a large blur radius with
+ * few samples per pixel.
+ */
 class wf_kawase_blur : public wf_blur_base
 {
+    /* levels[i] has 1 / 2^(i + 1) the size of fb[0]. The buffers are kept
+     * between frames, so that they are not reallocated for every iteration. */
+    std::vector<wf::auxilliary_buffer_t> levels;
+
+    wf::auxilliary_buffer_t& get_level(int i)
+    {
+        return (i == 0) ? fb[0] : levels[i - 1];
+    }
+
   public:
     wf_kawase_blur() : wf_blur_base("kawase")
     {
@@ -73,10 +88,19 @@ class wf_kawase_blur : public wf_blur_base
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
-        int iterations = iterations_opt;
+        int iterations = get_iterations();
         float offset = offset_opt;
         int sampleWidth, sampleHeight;
 
+        if ((int)levels.size() != iterations)
+        {
+            levels.resize(iterations);
+            for (auto& level : levels)
+            {
+                level.set_owner("blur: kawase pyramid");
+            }
+        }
+
         /* Upload data to shader */
         static const float vertexData[] = {
             -1.0f, -1.0f,
@@ -94,16 +118,17 @@ class wf_kawase_blur : public wf_blur_base
         GL_CALL(glDisable(GL_BLEND));
         program[0].uniform1f("offset", offset);
 
-        for (int i = 0; i < iterations; i++)
+        /* Only the copied tiles around the damage are blurred on each level. */
+        for (int i = 1; i <= iterations; i++)
         {
             sampleWidth  = width / (1 << i);
             sampleHeight = height / (1 << i);
 
-            auto region = blur_region * (1.0 / (1 << i));
+            auto region = copied_region * (1.0 / (1 << i));
 
             program[0].uniform2f("halfpixel",
                 0.5f / sampleWidth, 0.5f / sampleHeight);
-            render_iteration(region, fb[i % 2], fb[1 - i % 2], sampleWidth,
+            render_iteration(region, get_level(i - 1), get_level(i), sampleWidth,
                 sampleHeight);
         }
 
@@ -118,11 +143,12 @@ class wf_kawase_blur : public wf_blur_base
             sampleWidth  = width / (1 << i);
             sampleHeight = height / (1 << i);
 
-            auto region = blur_region * (1.0 / (1 << i));
+            /* The last iteration needs to produce only the damaged pixels. */
+            auto region = (i == 0) ? blur_region : copied_region * (1.0 / (1 << i));
 
             program[1].uniform2f("halfpixel",
                 0.5f / sampleWidth, 0.5f / sampleHeight);
-            render_iteration(region, fb[1 - i % 2], fb[i % 2], sampleWidth,
+            render_iteration(region, get_level(i + 1), get_level(i), sampleWidth,
                 sampleHeight);
         }
 
@@ -137,7 +163,7 @@ class wf_kawase_blur : public wf_blur_base
 
     int calculate_blur_radius() override
     {
-        return pow(2, iterations_opt + 1) * offset_opt * degrade_opt;
+        return pow(2, get_iterations() + 1) * offset_opt * degrade_opt;
     }
 };
 
@@ -244,6 +244,11 @@ class dragged_view_node_t : public wf::scene::node_t
             }
         }
 
+        void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            wf::scene::expand_damage_from_list(children_manager->get_instances(), target, damage, {0, 0});
+        }
+
         void presentation_feedback(wf::output_t *output) override
         {
             for (auto& instance : children_manager->get_instances())
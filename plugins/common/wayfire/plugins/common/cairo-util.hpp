@@ -339,6 +339,15 @@ struct cairo_text_t
         return this->tex.get_texture();
     }
 
+    /**
+     * Take ownership of the texture with the last rendered text, leaving this
+     * object without a texture.
+     */
+    owned_texture_t take_texture()
+    {
+        return std::move(this->tex);
+    }
+
   protected:
     /* cairo context and surface for the text */
     cairo_t *cr = nullptr;
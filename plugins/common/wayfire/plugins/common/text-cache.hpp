@@ -0,0 +1,225 @@
+#pragma once
+
+#include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace wf
+{
+/**
+ * Text rendered to a texture, as stored in the text cache.
+ */
+struct cached_text_t
+{
+    owned_texture_t texture;
+    /* The size needed to render the text, in pixels. If it is larger than the
+     * texture, the text was cropped. */
+    wf::dimensions_t needed_size = {0, 0};
+};
+
+/**
+ * A cache of rendered text, shared by all plugins which hold a
+ * wf::shared_data::ref_ptr_t<text_cache_t>.
+ *
+ * Laying out text with Pango and uploading the result is expensive, and the
+ * same strings (for example window titles in decorations and in scale) are
+ * rendered over and over. The cache keeps the textures keyed by the text and
+ * everything else which affects the result, and evicts the least recently
+ * used entries once their total size exceeds the budget. Evicted entries stay
+ * valid until their last user drops them.
+ */
+class text_cache_t
+{
+  public:
+    using render_func_t = std::function<std::shared_ptr<cached_text_t>()>;
+
+    /**
+     * Find the text with the given key.
+     *
+     * @return The cached text, or null if it is not in the cache.
+     */
+    std::shared_ptr<const cached_text_t> find(const std::string& key)
+    {
+        auto it = entries.find(key);
+        if (it == entries.end())
+        {
+            return nullptr;
+        }
+
+        lru.splice(lru.begin(), lru, it->second.lru_pos);
+        return it->second.text;
+    }
+
+    /**
+     * Add rendered text to the cache, replacing any text with the same key.
+     */
+    void insert(const std::string& key, std::shared_ptr<const cached_text_t> text)
+    {
+        erase(key);
+        auto size = text->texture.get_size();
+
+        lru.push_front(key);
+        auto& entry = entries[key];
+        entry.text    = std::move(text);
+        entry.lru_pos = lru.begin();
+        entry.bytes   = 4 * (size_t)size.width * size.height;
+        total_bytes  += entry.bytes;
+        evict();
+    }
+
+    /**
+     * Get the text with the given key, rendering it with @render if it is not
+     * in the cache.
+     *
+     * @param key A string identifying the text and all parameters used to
+     *   render it.
+     * @param render Renders the text on a cache miss.
+     */
+    std::shared_ptr<const cached_text_t> get(const std::string& key, const render_func_t& render)
+    {
+        if (auto text = find(key))
+        {
+            return text;
+        }
+
+        std::shared_ptr<const cached_text_t> text = render();
+        insert(key, text);
+        return text;
+    }
+
+    /**
+     * Get text which may be cropped to a maximal size, rendering it with
+     * @render if it is not in the cache.
+     *
+     * Text which fits into the maximal size does not depend on it, so it is
+     * stored once under @natural_key for all sizes. Only cropped text is stored
+     * under @cropped_key, which should include the maximal size.
+     *
+     * @param fits Whether text which needs the given size fits into the
+     *   maximal size.
+     * @param render Renders the text cropped to the maximal size, with
+     *   needed_size set to the uncropped size.
+     */
+    std::shared_ptr<const cached_text_t> get_natural_or_cropped(const std::string& natural_key,
+        const std::string& cropped_key, const std::function<bool(wf::dimensions_t)>& fits,
+        const render_func_t& render)
+    {
+        if (auto natural = find(natural_key))
+        {
+            if (fits(natural->needed_size))
+            {
+                return natural;
+            }
+        }
+
+        if (auto cropped = find(cropped_key))
+        {
+            return cropped;
+        }
+
+        std::shared_ptr<const cached_text_t> text = render();
+        insert(fits(text->needed_size) ? natural_key : cropped_key, text);
+        return text;
+    }
+
+    /**
+     * Set the maximal total size of the cached textures, in bytes.
+     */
+    void set_budget(size_t bytes)
+    {
+        budget = bytes;
+        evict();
+    }
+
+    /**
+     * @return The total size of the cached textures, in bytes.
+     */
+    size_t get_total_bytes() const
+    {
+        return total_bytes;
+    }
+
+  private:
+    struct entry_t
+    {
+        std::shared_ptr<const cached_text_t> text;
+        std::list<std::string>::iterator lru_pos;
+        size_t bytes = 0;
+    };
+
+    /* Keys of the entries, most recently used first. */
+    std::list<std::string> lru;
+    std::unordered_map<std::string, entry_t> entries;
+    size_t total_bytes = 0;
+    size_t budget = 32 << 20;
+
+    void erase(const std::string& key)
+    {
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            total_bytes -= it->second.bytes;
+            lru.erase(it->second.lru_pos);
+            entries.erase(it);
+        }
+    }
+
+    void evict()
+    {
+        // Always keep the most recent entry, it is in use.
+        while ((total_bytes > budget) && (lru.size() > 1))
+        {
+            auto it = entries.find(lru.back());
+            total_bytes -= it->second.bytes;
+            entries.erase(it);
+            lru.pop_back();
+        }
+    }
+};
+
+/**
+ * Render text like cairo_text_t::render_text() with par.exact_size set, and
+ * keep the result in the cache. Text which fits into par.max_size is cached
+ * once for all sizes, see text_cache_t::get_natural_or_cropped().
+ */
+inline std::shared_ptr<const cached_text_t> render_text_cached(text_cache_t& cache,
+    const std::string& text, const cairo_text_t::params& par)
+{
+    auto color_key = [] (const wf::color_t& c)
+    {
+        return std::to_string(c.r) + "," + std::to_string(c.g) + "," +
+               std::to_string(c.b) + "," + std::to_string(c.a);
+    };
+
+    auto make_key = [&] (wf::dimensions_t max_size)
+    {
+        return "cairo-text:" + std::to_string(par.font_size) + ":" +
+               color_key(par.bg_color) + ":" + color_key(par.text_color) + ":" +
+               std::to_string(par.output_scale) + ":" +
+               std::to_string(max_size.width) + "x" + std::to_string(max_size.height) + ":" +
+               std::to_string(par.bg_rect) + std::to_string(par.rounded_rect) + ":" + text;
+    };
+
+    auto fits = [&] (wf::dimensions_t needed)
+    {
+        return (!par.max_size.width || (needed.width <= par.max_size.width * par.output_scale)) &&
+               (!par.max_size.height || (needed.height <= par.max_size.height * par.output_scale));
+    };
+
+    return cache.get_natural_or_cropped(make_key({0, 0}), make_key(par.max_size), fits, [&]
+    {
+        auto params = par;
+        params.exact_size = true;
+
+        cairo_text_t renderer;
+        auto result = std::make_shared<cached_text_t>();
+        result->needed_size = renderer.render_text(text, params);
+        result->texture     = renderer.take_texture();
+        return result;
+    });
+}
+}
@@ -111,12 +111,35 @@ class workspace_wall_t : public wf::signal::provider_t
      */
     void set_ws_dim(const wf::point_t& ws, float value);
 
+    /**
+     * Set how long the buffer of a workspace is kept after the workspace leaves the viewport. Buffers are
+     * allocated when their workspace first becomes visible, so memory use follows what is shown.
+     *
+     * @param timeout_ms The time in milliseconds, or a negative value to keep the buffers until the output
+     *   renderer is stopped. The default is one second.
+     */
+    void set_buffer_release_timeout(int timeout_ms);
+
+    /**
+     * Keep low-resolution thumbnails of all workspaces while the wall is not shown.
+     *
+     * The thumbnails are rendered at the scale at which the whole wall fits on the output, and are updated
+     * from their accumulated damage every @interval_ms milliseconds. When the output renderer is started,
+     * the wall begins with the thumbnails instead of empty buffers, and refines the visible workspaces to a
+     * higher resolution as needed.
+     *
+     * @param enabled Whether to keep the thumbnails. Disabling frees them.
+     * @param interval_ms How often to update the thumbnails.
+     */
+    void set_warm_thumbnails(bool enabled, int interval_ms);
+
   protected:
     wf::output_t *output;
 
     wf::color_t background_color = {0, 0, 0, 0};
     int gap_size = 0;
     wf::geometry_t viewport = {0, 0, 0, 0};
+    int release_timeout_ms = 1000;
     std::map<std::pair<int, int>, float> render_colors;
     float get_color_for_workspace(wf::point_t ws);
 
@@ -126,6 +149,9 @@ class workspace_wall_t : public wf::signal::provider_t
     std::vector<wf::point_t> get_visible_workspaces(wf::geometry_t viewport) const;
 
   protected:
+    class warm_thumbnails_t;
+    std::unique_ptr<warm_thumbnails_t> warm_thumbnails;
+
     class workspace_wall_node_t;
     std::shared_ptr<workspace_wall_node_t> render_node;
 };
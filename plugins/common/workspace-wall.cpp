@@ -6,27 +6,134 @@
 #include "wayfire/scene.hpp"
 #include "wayfire/region.hpp"
 #include "wayfire/core.hpp"
+#include "wayfire/util.hpp"
 
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace wf
 {
 template<class Data> using per_workspace_map_t = std::map<int, std::map<int, Data>>;
 
+class workspace_wall_t::warm_thumbnails_t
+{
+  public:
+    warm_thumbnails_t(workspace_wall_t *wall) : wall(wall)
+    {}
+
+    void set_interval(int interval_ms)
+    {
+        timer.set_timeout(std::max(interval_ms, 1), [=] ()
+        {
+            update();
+            return true;
+        });
+    }
+
+    /**
+     * Render the damaged parts of the thumbnails. Recreates them if the workspace grid or the scale at which
+     * the wall is shown has changed.
+     */
+    void update()
+    {
+        if (wall->render_node)
+        {
+            // The wall is shown and updates what it needs by itself.
+            return;
+        }
+
+        auto grid = wall->output->wset()->get_workspace_grid_size();
+        const float new_scale = get_overview_scale();
+        if ((grid != textures_grid) || (new_scale != scale))
+        {
+            textures.clear();
+            textures_grid = grid;
+            scale = new_scale;
+            for (int i = 0; i < grid.width; i++)
+            {
+                for (int j = 0; j < grid.height; j++)
+                {
+                    textures[i][j] = workspace_texture_t::get(wall->output, {i, j}, ALL_LAYERS_MASK,
+                        scale * wall->output->handle->scale);
+                }
+            }
+        }
+
+        for (auto& [i, column] : textures)
+        {
+            for (auto& [j, texture] : column)
+            {
+                texture->update();
+            }
+        }
+    }
+
+    std::shared_ptr<workspace_texture_t> get(wf::point_t ws)
+    {
+        if (textures.count(ws.x) && textures[ws.x].count(ws.y))
+        {
+            return textures[ws.x][ws.y];
+        }
+
+        return nullptr;
+    }
+
+    float get_scale() const
+    {
+        return scale;
+    }
+
+  private:
+    workspace_wall_t *wall;
+    wf::wl_timer<true> timer;
+    per_workspace_map_t<std::shared_ptr<workspace_texture_t>> textures;
+    wf::dimensions_t textures_grid = {0, 0};
+    float scale = 1.0;
+
+    // The scale at which workspaces are shown when the whole wall fits on the output.
+    float get_overview_scale() const
+    {
+        auto bbox = wall->output->get_relative_geometry();
+        auto full = wall->get_wall_rectangle();
+        float overview_scale = std::min(
+            1.0 * bbox.width / full.width,
+            1.0 * bbox.height / full.height);
+        return std::min(overview_scale, 1.0f);
+    }
+};
+
 class workspace_wall_t::workspace_wall_node_t : public scene::node_t
 {
     class wwall_render_instance_t : public scene::render_instance_t
     {
         std::shared_ptr<workspace_wall_node_t> self;
-        per_workspace_map_t<std::vector<scene::render_instance_uptr>> instances;
 
         scene::damage_callback push_damage;
+        wf::wl_timer<true> release_timer;
         wf::signal::connection_t<scene::node_damage_signal> on_wall_damage =
             [=] (scene::node_damage_signal *ev)
         {
             push_damage(ev->region);
         };
 
+        wf::signal::connection_t<workspace_texture_damage_signal> on_workspace_damage =
+            [=] (workspace_texture_damage_signal *ev)
+        {
+            // Damage the 'screen' after transforming damage
+            auto ws = ev->texture->get_workspace();
+            wf::region_t our_damage;
+            for (auto& rect : ev->region)
+            {
+                wf::geometry_t box = wlr_box_from_pixman_box(rect);
+                box = box + wf::origin(get_workspace_rect(ws));
+                auto A = self->wall->viewport;
+                auto B = self->get_bounding_box();
+                our_damage |= scale_box(A, B, box);
+            }
+
+            push_damage(our_damage);
+        };
+
         wf::geometry_t get_workspace_rect(wf::point_t ws)
         {
             auto output_size = self->wall->output->get_screen_size();
@@ -46,31 +153,14 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
             this->push_damage = push_damage;
             self->connect(&on_wall_damage);
 
-            for (int i = 0; i < (int)self->workspaces.size(); i++)
+            for (auto& [i, column] : self->workspaces)
             {
-                for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                for (auto& [j, texture] : column)
                 {
-                    auto push_damage_child = [=] (const wf::region_t& damage)
+                    if (texture)
                     {
-                        // Store the damage because we'll have to update the buffers
-                        self->aux_buffer_damage[i][j] |= damage;
-
-                        wf::region_t our_damage;
-                        for (auto& rect : damage)
-                        {
-                            wf::geometry_t box = wlr_box_from_pixman_box(rect);
-                            box = box + wf::origin(get_workspace_rect({i, j}));
-                            auto A = self->wall->viewport;
-                            auto B = self->get_bounding_box();
-                            our_damage |= scale_box(A, B, box);
-                        }
-
-                        // Also damage the 'screen' after transforming damage
-                        push_damage(our_damage);
-                    };
-
-                    self->workspaces[i][j]->gen_render_instances(instances[i][j],
-                        push_damage_child, self->wall->output);
+                        texture->connect(&on_workspace_damage);
+                    }
                 }
             }
         }
@@ -86,7 +176,7 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
             return sum;
         }
 
-        bool consider_rescale_workspace_buffer(int i, int j, const wf::region_t& visible_damage)
+        void consider_rescale_workspace_buffer(int i, int j, const wf::region_t& visible_damage)
         {
             // In general, when rendering the auxilliary buffers for each workspace, we can render the
             // workspace thumbnails in a lower resolution, because at the end they are shown scaled.
@@ -98,7 +188,7 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
             //
             // Nonetheless, we need to make sure to rescale when this makes sense, and to avoid visual
             // artifacts.
-            auto bbox = self->workspaces[i][j]->get_bounding_box();
+            auto bbox = self->wall->output->get_relative_geometry();
             float render_scale = std::max(
                 1.0 * bbox.width / self->wall->viewport.width,
                 1.0 * bbox.height / self->wall->viewport.height);
@@ -121,59 +211,90 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
 
             if ((repaint_cost_current_scale > repaint_rescale_cost) || rescale_magnification)
             {
+                // Textures are shared by scale, so switch to the texture with the new scale. It is fully
+                // damaged unless another plugin already uses it.
                 self->aux_buffer_current_scale[i][j] = render_scale;
-                const auto full_size   = self->aux_buffers[i][j].get_size();
-                const int scaled_width = std::clamp(std::ceil(render_scale * full_size.width),
-                    1.0f, 1.0f * full_size.width);
-                const int scaled_height = std::clamp(std::ceil(render_scale * full_size.height),
-                    1.0f, 1.0f * full_size.height);
-
-                self->aux_buffer_current_subbox[i][j] = wf::geometry_t{0, 0, scaled_width, scaled_height};
-                self->aux_buffer_damage[i][j] |= self->workspaces[i][j]->get_bounding_box();
-                return true;
+                self->workspaces[i][j]->disconnect(&on_workspace_damage);
+                self->workspaces[i][j] = self->get_texture({i, j}, render_scale);
+                self->workspaces[i][j]->connect(&on_workspace_damage);
+            }
+        }
+
+        /**
+         * Drop the textures of workspaces which have not been visible in the viewport for the release
+         * timeout. They are recreated (fully damaged) when they become visible again.
+         *
+         * @return Whether there are hidden workspaces whose textures are kept for now.
+         */
+        bool release_hidden_textures()
+        {
+            const int64_t now = wf::get_current_time();
+            bool has_hidden   = false;
+            for (auto& [i, column] : self->workspaces)
+            {
+                for (auto& [j, texture] : column)
+                {
+                    if (!texture || (self->wall->viewport & self->wall->get_workspace_rectangle({i, j})))
+                    {
+                        continue;
+                    }
+
+                    if (now - self->last_visible[i][j] >= self->wall->release_timeout_ms)
+                    {
+                        texture->disconnect(&on_workspace_damage);
+                        texture = nullptr;
+                    } else
+                    {
+                        has_hidden = true;
+                    }
+                }
             }
 
-            return false;
+            return has_hidden;
         }
 
         void schedule_instructions(
             std::vector<scene::render_instruction_t>& instructions,
             const wf::render_target_t& target, wf::region_t& damage) override
         {
-            // Update workspaces in a render pass
-            for (int i = 0; i < (int)self->workspaces.size(); i++)
+            // Update the visible parts of the workspaces. Damage outside of the viewport is kept in the
+            // textures until it becomes visible.
+            const int64_t now = wf::get_current_time();
+            bool has_hidden   = false;
+            for (auto& [i, column] : self->workspaces)
             {
-                for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                for (auto& [j, texture] : column)
                 {
-                    const auto ws_bbox     = self->wall->get_workspace_rectangle({i, j});
-                    const auto visible_box =
-                        geometry_intersection(self->wall->viewport, ws_bbox) - wf::origin(ws_bbox);
-                    wf::region_t visible_damage = self->aux_buffer_damage[i][j] & visible_box;
-                    if (consider_rescale_workspace_buffer(i, j, visible_damage))
+                    const auto ws_bbox = self->wall->get_workspace_rectangle({i, j});
+                    if (!(self->wall->viewport & ws_bbox))
                     {
-                        visible_damage |= visible_box;
+                        has_hidden |= (texture != nullptr);
+                        continue;
                     }
 
-                    if (!visible_damage.empty())
+                    self->last_visible[i][j] = now;
+                    if (!texture)
                     {
-                        wf::render_target_t aux{self->aux_buffers[i][j]};
-                        aux.subbuffer = self->aux_buffer_current_subbox[i][j];
-                        aux.geometry  = self->workspaces[i][j]->get_bounding_box();
-                        aux.scale     = self->wall->output->handle->scale;
-
-                        render_pass_params_t params;
-                        params.instances = &instances[i][j];
-                        params.damage    = visible_damage;
-                        params.reference_output = self->wall->output;
-                        params.target = aux;
-                        params.flags  = RPASS_EMIT_SIGNALS;
-                        wf::render_pass_t::run(params);
-
-                        self->aux_buffer_damage[i][j] ^= visible_damage;
+                        texture = self->get_texture({i, j}, self->aux_buffer_current_scale[i][j]);
+                        texture->connect(&on_workspace_damage);
                     }
+
+                    const auto visible_box =
+                        geometry_intersection(self->wall->viewport, ws_bbox) - wf::origin(ws_bbox);
+                    wf::region_t visible_damage = texture->get_pending_damage() & visible_box;
+                    consider_rescale_workspace_buffer(i, j, visible_damage);
+                    texture->update(visible_box);
                 }
             }
 
+            if (has_hidden && !release_timer.is_connected() && (self->wall->release_timeout_ms >= 0))
+            {
+                release_timer.set_timeout(self->wall->release_timeout_ms + 1, [=] ()
+                {
+                    return release_hidden_textures();
+                });
+            }
+
             // Render the wall
             instructions.push_back(scene::render_instruction_t{
                     .instance = this,
@@ -189,30 +310,24 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
             data.pass->clear(data.damage, self->wall->background_color);
 
             auto damage = data.target.framebuffer_region_from_geometry_region(data.damage);
-            for (int i = 0; i < (int)self->workspaces.size(); i++)
+            for (auto& [i, column] : self->workspaces)
             {
-                for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                for (auto& [j, texture] : column)
                 {
+                    if (!texture)
+                    {
+                        continue;
+                    }
+
                     auto box = wf::geometry_to_fbox(get_workspace_rect({i, j}));
                     auto A   = wf::geometry_to_fbox(self->wall->viewport);
                     auto B   = wf::geometry_to_fbox(self->get_bounding_box());
                     auto render_geometry = wf::scale_fbox(A, B, box);
-                    auto& buffer = self->aux_buffers[i][j];
 
                     float dim = self->wall->get_color_for_workspace({i, j});
-                    const auto& subbox = self->aux_buffer_current_subbox[i][j];
 
-                    auto tex = wf::texture_t{buffer.get_texture()};
+                    auto tex = texture->get_texture();
                     tex.filter_mode = WLR_SCALE_FILTER_BILINEAR;
-                    if (subbox.has_value())
-                    {
-                        tex.source_box = {
-                            1.0 * subbox->x,
-                            1.0 * subbox->y,
-                            1.0 * subbox->width,
-                            1.0 * subbox->height};
-                    }
-
                     data.pass->add_texture(tex, data.target, render_geometry, data.damage);
                     data.pass->add_rect({0, 0, 0, 1.0 - dim}, data.target,
                         render_geometry, data.damage);
@@ -224,14 +339,30 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
 
         void compute_visibility(wf::output_t *output, wf::region_t& visible) override
         {
-            for (int i = 0; i < (int)self->workspaces.size(); i++)
+            for (auto& [i, column] : self->workspaces)
+            {
+                for (auto& [j, texture] : column)
+                {
+                    if (!texture)
+                    {
+                        continue;
+                    }
+
+                    wf::region_t ws_region = output->get_relative_geometry();
+                    texture->compute_visibility(ws_region);
+                }
+            }
+        }
+
+        void presentation_feedback(wf::output_t *output) override
+        {
+            for (auto& [i, column] : self->workspaces)
             {
-                for (int j = 0; j < (int)self->workspaces[i].size(); j++)
+                for (auto& [j, texture] : column)
                 {
-                    wf::region_t ws_region = self->workspaces[i][j]->get_bounding_box();
-                    for (auto& ch : this->instances[i][j])
+                    if (texture)
                     {
-                        ch->compute_visibility(output, ws_region);
+                        texture->presentation_feedback();
                     }
                 }
             }
@@ -245,28 +376,34 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
     {
         this->wall  = wall;
         auto [w, h] = wall->output->wset()->get_workspace_grid_size();
-        workspaces.resize(w);
         for (int i = 0; i < w; i++)
         {
             for (int j = 0; j < h; j++)
             {
-                auto node = std::make_shared<workspace_stream_node_t>(
-                    wall->output, wf::point_t{i, j});
-                workspaces[i].push_back(node);
-
-                auto bbox = workspaces[i][j]->get_bounding_box();
-
-                aux_buffers[i][j].allocate(wf::dimensions(bbox), wall->output->handle->scale,
-                    wf::buffer_allocation_hints_t{
-                        .needs_alpha = false,
-                    });
-                aux_buffer_damage[i][j] |= bbox;
-                aux_buffer_current_scale[i][j]  = 1.0;
-                aux_buffer_current_subbox[i][j] = std::nullopt;
+                // Start with the warm thumbnail if there is one, it is refined when necessary.
+                auto warm = wall->warm_thumbnails ? wall->warm_thumbnails->get({i, j}) : nullptr;
+                if (warm)
+                {
+                    workspaces[i][j] = warm;
+                    aux_buffer_current_scale[i][j] = wall->warm_thumbnails->get_scale();
+                } else
+                {
+                    // The texture is created when the workspace first becomes visible in the viewport.
+                    workspaces[i][j] = nullptr;
+                    aux_buffer_current_scale[i][j] = 1.0;
+                }
+
+                last_visible[i][j] = wf::get_current_time();
             }
         }
     }
 
+    std::shared_ptr<workspace_texture_t> get_texture(wf::point_t ws, float render_scale)
+    {
+        return workspace_texture_t::get(wall->output, ws, ALL_LAYERS_MASK,
+            render_scale * wall->output->handle->scale);
+    }
+
     virtual void gen_render_instances(
         std::vector<scene::render_instance_uptr>& instances,
         scene::damage_callback push_damage, wf::output_t *shown_on) override
@@ -292,16 +429,14 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
 
   private:
     workspace_wall_t *wall;
-    std::vector<std::vector<std::shared_ptr<workspace_stream_node_t>>> workspaces;
-
-    // Buffers keeping the contents of almost-static workspaces
-    per_workspace_map_t<wf::auxilliary_buffer_t> aux_buffers;
-    // Damage accumulated for those buffers
-    per_workspace_map_t<wf::region_t> aux_buffer_damage;
+    // Textures keeping the contents of almost-static workspaces. They are kept in the node, so that they
+    // survive regenerating the render instances, and are shared with other plugins showing the same
+    // workspaces at the same scale. Null for workspaces which are not in use.
+    per_workspace_map_t<std::shared_ptr<workspace_texture_t>> workspaces;
     // Current rendering scale for the workspace
     per_workspace_map_t<float> aux_buffer_current_scale;
-    // Current subbox for the workspace
-    per_workspace_map_t<std::optional<wf::geometry_t>> aux_buffer_current_subbox;
+    // The last time (in milliseconds) the workspace was visible in the viewport
+    per_workspace_map_t<int64_t> last_visible;
 };
 
 workspace_wall_t::workspace_wall_t(wf::output_t *_output) : output(_output)
@@ -397,6 +532,27 @@ void workspace_wall_t::set_ws_dim(const wf::point_t& ws, float value)
     }
 }
 
+void workspace_wall_t::set_buffer_release_timeout(int timeout_ms)
+{
+    this->release_timeout_ms = timeout_ms;
+}
+
+void workspace_wall_t::set_warm_thumbnails(bool enabled, int interval_ms)
+{
+    if (!enabled)
+    {
+        warm_thumbnails.reset();
+        return;
+    }
+
+    if (!warm_thumbnails)
+    {
+        warm_thumbnails = std::make_unique<warm_thumbnails_t>(this);
+    }
+
+    warm_thumbnails->set_interval(interval_ms);
+}
+
 float workspace_wall_t::get_color_for_workspace(wf::point_t ws)
 {
     auto it = render_colors.find({ws.x, ws.y});
@@ -346,61 +346,11 @@ class windows_only_workspace_node_t : public wf::scene::node_t
     }
 };
 
-// Custom node that shows only desktop/background (no windows)
-class desktop_only_workspace_node_t : public wf::scene::node_t
-{
-    wf::output_t *output;
-    wf::point_t workspace;
-    
-  public:
-    desktop_only_workspace_node_t(wf::output_t *output, wf::point_t ws) : node_t(false)
-    {
-        this->output = output;
-        this->workspace = ws;
-    }
-    
-    void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
-        wf::scene::damage_callback push_damage, wf::output_t *shown_on) override
-    {
-        if (shown_on != output)
-        {
-            return;
-        }
-        
-        // Get the workspace scene graph
-        auto wset = output->wset();
-        auto views = wset->get_views();
-        
-        // We want to render everything EXCEPT window views
-        // This means rendering background layers only
-        auto root = output->node_for_layer(wf::scene::layer::BACKGROUND);
-        if (root)
-        {
-            root->gen_render_instances(instances, push_damage, shown_on);
-        }
-        
-        auto bottom = output->node_for_layer(wf::scene::layer::BOTTOM);
-        if (bottom)
-        {
-            bottom->gen_render_instances(instances, push_damage, shown_on);
-        }
-    }
-    
-    wf::geometry_t get_bounding_box() override
-    {
-        return output->get_layout_geometry();
-    }
-};
-
 class cube_render_instance_t : public wf::scene::render_instance_t
 {
     std::shared_ptr<cube_render_node_t> self;
     wf::scene::damage_callback push_damage;
 
-    std::vector<std::vector<wf::scene::render_instance_uptr>> ws_instances;
-    std::vector<wf::region_t> ws_damage;
-    std::vector<wf::auxilliary_buffer_t> framebuffers;
-
     // NEW: Framebuffers for window-only cubes
     std::vector<wf::auxilliary_buffer_t> framebuffers_windows;
     std::vector<std::vector<wf::auxilliary_buffer_t>> framebuffers_windows_rows;
@@ -414,11 +364,6 @@ class cube_render_instance_t : public wf::scene::render_instance_t
 std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>> ws_instance_managers_windows;
 std::vector<std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>>> ws_instance_managers_windows_rows;
 
-    // Multiple cube workspaces for all rows
-    std::vector<std::vector<std::vector<wf::scene::render_instance_uptr>>> ws_instances_rows;
-    std::vector<std::vector<wf::region_t>> ws_damage_rows;
-    std::vector<std::vector<wf::auxilliary_buffer_t>> framebuffers_rows;
-
 
     std::vector<wf::region_t> ws_damage_windows;
     std::vector<std::vector<wf::region_t>> ws_damage_windows_rows;
@@ -429,6 +374,13 @@ std::vector<std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>>>
         push_damage(ev->region);
     };
 
+    // The desktop faces are shared workspace textures, so any change on them repaints the whole cube.
+    wf::signal::connection_t<wf::workspace_texture_damage_signal> on_face_damage =
+        [=] (wf::workspace_texture_damage_signal *ev)
+    {
+        push_damage(self->get_bounding_box());
+    };
+
   public:
    cube_render_instance_t(cube_render_node_t *self, wf::scene::damage_callback push_damage)
 {
@@ -436,15 +388,21 @@ std::vector<std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>>>
     this->push_damage = push_damage;
     self->connect(&on_cube_damage);
     
-    ws_damage.resize(self->workspaces.size());
-    framebuffers.resize(self->workspaces.size());
-    ws_instances.resize(self->workspaces.size());
-    
+    for (auto& face : self->workspaces)
+    {
+        face->connect(&on_face_damage);
+    }
+
+    for (auto& row : self->workspaces_all_rows)
+    {
+        for (auto& face : row)
+        {
+            face->connect(&on_face_damage);
+        }
+    }
+
     // Initialize storage for all rows
     int num_rows = self->workspaces_all_rows.size();
-    ws_damage_rows.resize(num_rows);
-    framebuffers_rows.resize(num_rows);
-    ws_instances_rows.resize(num_rows);
     
     // IMPORTANT: Resize window storage BEFORE creating managers
     ws_damage_windows.resize(self->workspaces_windows.size());
@@ -462,21 +420,6 @@ std::vector<std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>>>
         ws_instance_managers_windows_rows[row].resize(self->workspaces_windows_rows[row].size());
     }
     
-    // Initialize top cube workspaces (current row)
-    for (int i = 0; i < (int)self->workspaces.size(); i++)
-    {
-        auto push_damage_child = [=] (const wf::region_t& damage)
-        {
-            ws_damage[i] |= damage;
-            push_damage(self->get_bounding_box());
-        };
-        
-        self->workspaces[i]->gen_render_instances(ws_instances[i],
-            push_damage_child, self->cube->output);
-        
-        ws_damage[i] |= self->workspaces[i]->get_bounding_box();
-    }
-    
     // NOW create window managers after everything is resized
     for (int i = 0; i < (int)self->workspaces_windows.size(); i++)
     {
@@ -499,27 +442,9 @@ std::vector<std::vector<std::unique_ptr<wf::scene::render_instance_manager_t>>>
         ws_damage_windows[i] |= self->workspaces_windows[i]->get_bounding_box();
     }
     
-    // Initialize all other row workspaces
+    // Initialize all other rows
     for (int row = 0; row < num_rows; row++)
     {
-        ws_damage_rows[row].resize(self->workspaces_all_rows[row].size());
-        framebuffers_rows[row].resize(self->workspaces_all_rows[row].size());
-        ws_instances_rows[row].resize(self->workspaces_all_rows[row].size());
-        
-        for (int i = 0; i < (int)self->workspaces_all_rows[row].size(); i++)
-        {
-            auto push_damage_child = [=] (const wf::region_t& damage)
-            {
-                ws_damage_rows[row][i] |= damage;
-                push_damage(self->get_bounding_box());
-            };
-            
-            self->workspaces_all_rows[row][i]->gen_render_instances(ws_instances_rows[row][i],
-                push_damage_child, self->cube->output);
-            
-            ws_damage_rows[row][i] |= self->workspaces_all_rows[row][i]->get_bounding_box();
-        }
-        
         // Create window managers for this row
         for (int i = 0; i < (int)self->workspaces_windows_rows[row].size(); i++)
         {
@@ -579,26 +504,10 @@ void schedule_instructions(
     auto bbox = self->get_bounding_box();
     damage ^= bbox;
 
-    // Render top cube workspaces (current row) - WITH BACKGROUND
-    for (int i = 0; i < (int)ws_instances.size(); i++)
+    // Update top cube workspaces (current row) - WITH BACKGROUND
+    for (auto& face : self->workspaces)
     {
-        const float scale = self->cube->output->handle->scale;
-        auto bbox = self->workspaces[i]->get_bounding_box();
-        framebuffers[i].allocate(wf::dimensions(bbox), scale);
-
-        wf::render_target_t target{framebuffers[i]};
-        target.geometry = self->workspaces[i]->get_bounding_box();
-        target.scale    = self->cube->output->handle->scale;
-
-        wf::render_pass_params_t params;
-        params.instances = &ws_instances[i];
-        params.damage    = ws_damage[i];
-        params.reference_output = self->cube->output;
-        params.target = target;
-        params.flags  = wf::RPASS_CLEAR_BACKGROUND | wf::RPASS_EMIT_SIGNALS;
-
-        wf::render_pass_t::run(params);
-        ws_damage[i].clear();
+        face->update();
     }
     
     // Render window-only workspaces dynamically (top row)
@@ -609,6 +518,7 @@ for (int i = 0; i < (int)ws_instance_managers_windows.size(); i++)
 {
     const float scale = self->cube->output->handle->scale;
     auto bbox = self->cube->output->get_layout_geometry();
+    framebuffers_windows[i].set_owner("cube: window layers");
     framebuffers_windows[i].allocate(wf::dimensions(bbox), scale);
 
     // Calculate which workspace this represents
@@ -641,28 +551,12 @@ for (int i = 0; i < (int)ws_instance_managers_windows.size(); i++)
     ws_damage_windows[i].clear();
 }
 
-    // Render all other row workspaces - WITH BACKGROUND
-    for (int row = 0; row < (int)ws_instances_rows.size(); row++)
+    // Update all other row workspaces - WITH BACKGROUND
+    for (auto& row : self->workspaces_all_rows)
     {
-        for (int i = 0; i < (int)ws_instances_rows[row].size(); i++)
+        for (auto& face : row)
         {
-            const float scale = self->cube->output->handle->scale;
-            auto bbox = self->workspaces_all_rows[row][i]->get_bounding_box();
-            framebuffers_rows[row][i].allocate(wf::dimensions(bbox), scale);
-
-            wf::render_target_t target{framebuffers_rows[row][i]};
-            target.geometry = self->workspaces_all_rows[row][i]->get_bounding_box();
-            target.scale    = self->cube->output->handle->scale;
-
-            wf::render_pass_params_t params;
-            params.instances = &ws_instances_rows[row][i];
-            params.damage    = ws_damage_rows[row][i];
-            params.reference_output = self->cube->output;
-            params.target = target;
-            params.flags  = wf::RPASS_CLEAR_BACKGROUND | wf::RPASS_EMIT_SIGNALS;
-
-            wf::render_pass_t::run(params);
-            ws_damage_rows[row][i].clear();
+            face->update();
         }
     }
     
@@ -673,6 +567,7 @@ for (int row = 0; row < (int)ws_instance_managers_windows_rows.size(); row++)
     {
         const float scale = self->cube->output->handle->scale;
         auto bbox = self->cube->output->get_layout_geometry();
+        framebuffers_windows_rows[row][i].set_owner("cube: window layers");
         framebuffers_windows_rows[row][i].allocate(wf::dimensions(bbox), scale);
 
         auto cws = self->cube->output->wset()->get_current_workspace();
@@ -725,6 +620,7 @@ void render_view_to_buffer(wayfire_view view, wf::auxilliary_buffer_t& buffer)
     }
     
     auto vg = toplevel->get_geometry();
+    buffer.set_owner("cube: view contents");
     buffer.allocate(wf::dimensions(vg), 1.0f);
     
     // Create render instance manager for this view
@@ -762,21 +658,52 @@ void render_view_to_buffer(wayfire_view view, wf::auxilliary_buffer_t& buffer)
     wf::render_pass_t::run(params);
 }
 
+static GLuint get_texture_id(const std::shared_ptr<wf::workspace_texture_t>& face)
+{
+    return wf::gles_texture_t{face->get_texture()}.tex_id;
+}
+
+static GLuint get_texture_id(wf::auxilliary_buffer_t& buffer)
+{
+    return wf::gles_texture_t::from_aux(buffer).tex_id;
+}
+
+template<class T>
+static std::vector<GLuint> get_texture_ids(std::vector<T>& faces)
+{
+    std::vector<GLuint> ids;
+    for (auto& face : faces)
+    {
+        ids.push_back(get_texture_id(face));
+    }
+
+    return ids;
+}
+
+template<class T>
+static std::vector<std::vector<GLuint>> get_texture_ids(std::vector<std::vector<T>>& rows)
+{
+    std::vector<std::vector<GLuint>> ids;
+    for (auto& row : rows)
+    {
+        ids.push_back(get_texture_ids(row));
+    }
+
+    return ids;
+}
+
 void render(const wf::scene::render_instruction_t& data) override
 {
-    self->cube->render(data, framebuffers, framebuffers_rows, 
-                      framebuffers_windows, framebuffers_windows_rows);
+    self->cube->render(data, get_texture_ids(self->workspaces), get_texture_ids(self->workspaces_all_rows),
+        get_texture_ids(framebuffers_windows), get_texture_ids(framebuffers_windows_rows));
 }
 
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
-        for (int i = 0; i < (int)self->workspaces.size(); i++)
+        for (auto& face : self->workspaces)
         {
-            wf::region_t ws_region = self->workspaces[i]->get_bounding_box();
-            for (auto& ch : this->ws_instances[i])
-            {
-                ch->compute_visibility(output, ws_region);
-            }
+            wf::region_t ws_region = output->get_relative_geometry();
+            face->compute_visibility(ws_region);
         }
         
         // NEW: Compute visibility for window-only top row
@@ -808,6 +735,7 @@ for (int i = 0; i < (int)ws_instance_managers_windows.size(); i++)
     {
         const float scale = self->cube->output->handle->scale;
         auto bbox = self->cube->output->get_layout_geometry();
+        framebuffers_windows_rows[row][i].set_owner("cube: window layers");
         framebuffers_windows_rows[row][i].allocate(wf::dimensions(bbox), scale);
 
         wf::render_target_t fb_target{framebuffers_windows_rows[row][i]};
@@ -828,6 +756,22 @@ for (int i = 0; i < (int)ws_instance_managers_windows.size(); i++)
     }
 }
     }
+
+    void presentation_feedback(wf::output_t *output) override
+    {
+        for (auto& face : self->workspaces)
+        {
+            face->presentation_feedback();
+        }
+
+        for (auto& row : self->workspaces_all_rows)
+        {
+            for (auto& face : row)
+            {
+                face->presentation_feedback();
+            }
+        }
+    }
 };
 
       public:
@@ -841,9 +785,8 @@ cube_render_node_t(wayfire_cube *cube) : node_t(false)
     // Top cube - current row
     for (int i = 0; i < w; i++)
     {
-        // CHANGED: Use desktop-only for regular cube
-        auto node = std::make_shared<desktop_only_workspace_node_t>(cube->output, wf::point_t{i, y});
-        workspaces.push_back(node);
+        // Desktop-only for regular cube
+        workspaces.push_back(get_desktop_texture({i, y}));
         
         // Window-only for popout cube
         auto node_windows = std::make_shared<windows_only_workspace_node_t>(cube->output, wf::point_t{i, y});
@@ -854,14 +797,13 @@ cube_render_node_t(wayfire_cube *cube) : node_t(false)
     for (int row_offset = 1; row_offset < h; row_offset++)
     {
         int target_y = (y + row_offset) % h;
-        std::vector<std::shared_ptr<wf::scene::node_t>> row_workspaces;
+        std::vector<std::shared_ptr<wf::workspace_texture_t>> row_workspaces;
         std::vector<std::shared_ptr<wf::scene::node_t>> row_workspaces_windows;
         
         for (int i = 0; i < w; i++)
         {
-            // CHANGED: Desktop-only for regular cube
-            auto node = std::make_shared<desktop_only_workspace_node_t>(cube->output, wf::point_t{i, target_y});
-            row_workspaces.push_back(node);
+            // Desktop-only for regular cube
+            row_workspaces.push_back(get_desktop_texture({i, target_y}));
             
             // Window-only for popout
             auto node_windows = std::make_shared<windows_only_workspace_node_t>(cube->output, wf::point_t{i, target_y});
@@ -892,8 +834,16 @@ cube_render_node_t(wayfire_cube *cube) : node_t(false)
         }
 
 private:
-    std::vector<std::shared_ptr<wf::scene::node_t>> workspaces;  // Changed type
-    std::vector<std::vector<std::shared_ptr<wf::scene::node_t>>> workspaces_all_rows;  // Changed type
+    std::shared_ptr<wf::workspace_texture_t> get_desktop_texture(wf::point_t ws)
+    {
+        return wf::workspace_texture_t::get(cube->output, ws,
+            wf::layer_to_mask(wf::scene::layer::BACKGROUND) | wf::layer_to_mask(wf::scene::layer::BOTTOM),
+            cube->output->handle->scale);
+    }
+
+    // Desktop faces, kept in the node so that they survive regenerating the render instances
+    std::vector<std::shared_ptr<wf::workspace_texture_t>> workspaces;
+    std::vector<std::vector<std::shared_ptr<wf::workspace_texture_t>>> workspaces_all_rows;
     
     std::vector<std::shared_ptr<wf::scene::node_t>> workspaces_windows;
     std::vector<std::vector<std::shared_ptr<wf::scene::node_t>>> workspaces_windows_rows;
@@ -943,6 +893,30 @@ private:
     wf::option_wrapper_t<bool> use_light{"cube/light"};
     wf::option_wrapper_t<int> use_deform{"cube/deform"};
 
+    // Each step of quality reduction requested by the output halves the tessellation level of the deformed
+    // and lit cube.
+    static constexpr int MAX_LOD_REDUCTION = 3;
+    int lod_reduction = 0;
+
+    wf::quality_callback_t on_quality_change = [=] (bool reduce)
+    {
+        if (!tessellation_support || (!use_deform && !use_light))
+        {
+            return false;
+        }
+
+        const int new_reduction = reduce ? std::min(lod_reduction + 1, MAX_LOD_REDUCTION) :
+            std::max(lod_reduction - 1, 0);
+        if (new_reduction == lod_reduction)
+        {
+            return false;
+        }
+
+        lod_reduction = new_reduction;
+        output->render->damage_whole();
+        return true;
+    };
+
     std::string last_background_mode;
     std::unique_ptr<wf_cube_background_base> background;
 
@@ -1193,6 +1167,8 @@ void render_shader_background(const wf::render_target_t& target)
         wf::scene::add_front(wf::get_core().scene(), render_node);
         output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
         output->render->set_require_depth_buffer(true);
+        lod_reduction = 0;
+        output->render->add_quality_callback(&on_quality_change);
 //        output->wset()->set_workspace({0, 0});
 
 
@@ -1254,6 +1230,7 @@ void deactivate()
 
     render_node = nullptr;
     output->render->rem_effect(&pre_hook);
+    output->render->rem_quality_callback(&on_quality_change);
   //  output->render->set_require_depth_buffer(false);
 
 wf::gles::run_in_context([&]
@@ -1519,7 +1496,7 @@ glm::mat4 calculate_model_matrix(int i, float vertical_offset = 0.0f, float scal
     return vertical_translation * rotation * scale_matrix * translation;
 }
     /* Render the sides of the cube, using the given culling mode - cw or ccw */
-void render_cube(GLuint front_face, std::vector<wf::auxilliary_buffer_t>& buffers, float vertical_offset = 0.0f, float scale = 1.0f)
+void render_cube(GLuint front_face, const std::vector<GLuint>& textures, float vertical_offset = 0.0f, float scale = 1.0f)
 {
 
     // Force depth test state at start of every cube render
@@ -1553,7 +1530,7 @@ void render_cube(GLuint front_face, std::vector<wf::auxilliary_buffer_t>& buffer
     for (int i = 0; i < get_num_faces(); i++)
     {
         int index = (cws.x + i) % get_num_faces();
-        auto tex_id = wf::gles_texture_t::from_aux(buffers[index]).tex_id;
+        auto tex_id = textures[index];
         
         // NEW: Log texture info
       //  LOGI("Binding texture ", tex_id, " for face ", i, " scale=", scale);
@@ -1716,7 +1693,9 @@ void render_cap_textures()
     auto bbox = output->get_layout_geometry();
     
     // Allocate cap buffers
+    top_cap_buffer.set_owner("cube: caps");
     top_cap_buffer.allocate(wf::dimensions(bbox), scale);
+    bottom_cap_buffer.set_owner("cube: caps");
     bottom_cap_buffer.allocate(wf::dimensions(bbox), scale);
     
     // Get the actual color values (cast option_wrapper to wf::color_t)
@@ -1747,10 +1726,10 @@ void render_cap_textures()
 
 
     void render(const wf::scene::render_instruction_t& data, 
-                std::vector<wf::auxilliary_buffer_t>& buffers, 
-                std::vector<std::vector<wf::auxilliary_buffer_t>>& buffers_rows,
-                std::vector<wf::auxilliary_buffer_t>& buffers_windows,
-                std::vector<std::vector<wf::auxilliary_buffer_t>>& buffers_windows_rows)
+                const std::vector<GLuint>& buffers, 
+                const std::vector<std::vector<GLuint>>& buffers_rows,
+                const std::vector<GLuint>& buffers_windows,
+                const std::vector<std::vector<GLuint>>& buffers_windows_rows)
     {
         data.pass->custom_gles_subpass([&]
         {
@@ -1796,6 +1775,7 @@ void render_cap_textures()
                 program.uniform1i("deform", use_deform);
                 program.uniform1i("light", use_light);
                 program.uniform1f("ease", animation.cube_animation.ease_deformation);
+                program.uniform1f("tessScale", 1.0f / (1 << lod_reduction));
                 
                 GLint loc = glGetUniformLocation(program.get_program_id(wf::TEXTURE_TYPE_RGBA), "cameraYOffset");
                 if (loc >= 0)
@@ -25,6 +25,7 @@ out vec2 uv[];
 
 uniform int deform;
 uniform int light;
+uniform float tessScale;
 
 void main() {
     tcPosition[ID] = vPos[ID];
@@ -41,6 +42,9 @@ void main() {
         if(light > 0)
             tessLevel = 50.0f;
 
+        /* lower level of detail when the output is over its frame budget */
+        tessLevel = max(1.0f, tessLevel * tessScale);
+
         gl_TessLevelInner[0] = tessLevel;
         gl_TessLevelOuter[0] = tessLevel;
         gl_TessLevelOuter[1] = tessLevel;
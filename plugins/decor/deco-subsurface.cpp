@@ -40,6 +40,9 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         }
     };
 
+    // Truncated titles are rendered wider in steps of this many pixels when the titlebar grows.
+    static constexpr int TITLE_WIDTH_STEP = 128;
+
     void update_title(int width, int height, double scale)
     {
         if (auto view = _view.lock())
@@ -49,20 +52,32 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
                 static_cast<int32_t>(height * scale)
             };
 
-            if ((title_texture.tex.get_size() != target_size) ||
-                (title_texture.current_text != view->get_title()))
+            // The title is rendered at its natural width and clipped to the titlebar, so resizing the view
+            // does not require rendering it again, unless a truncated title gets more space.
+            const int rendered_width = title_texture.tex ? title_texture.tex->texture.get_size().width : 0;
+            const bool truncated     = title_texture.tex &&
+                (title_texture.tex->needed_size.width > rendered_width);
+
+            if (!title_texture.tex ||
+                (title_texture.height != target_size.height) ||
+                (title_texture.current_text != view->get_title()) ||
+                (truncated && (target_size.width > rendered_width)))
             {
-                auto surface = theme.render_text(view->get_title(), target_size.width, target_size.height);
-                title_texture.tex = wf::owned_texture_t{surface};
-                cairo_surface_destroy(surface);
+                const int max_width = (target_size.width / TITLE_WIDTH_STEP + 1) * TITLE_WIDTH_STEP;
+                title_texture.tex = theme.render_title(*text_cache.get(), view->get_title(),
+                    target_size.height, max_width);
+                title_texture.height = target_size.height;
                 title_texture.current_text = view->get_title();
             }
         }
     }
 
+    // Titles are shared with other decorations and plugins showing the same text.
+    wf::shared_data::ref_ptr_t<wf::text_cache_t> text_cache;
     struct
     {
-        wf::owned_texture_t tex;
+        std::shared_ptr<const wf::cached_text_t> tex;
+        int height = 0;
         std::string current_text = "";
     } title_texture;
 
@@ -124,10 +139,18 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
             {
                 wf::geometry_t title_geometry = item->get_geometry() + origin;
                 update_title(title_geometry.width, title_geometry.height, data.target.scale);
-                if (title_texture.tex.get_texture().texture != NULL)
+                auto tex = title_texture.tex ? title_texture.tex->texture.get_texture() : wf::texture_t{};
+                if (tex.texture != NULL)
                 {
-                    data.pass->add_texture(title_texture.tex.get_texture(), data.target,
-                        title_geometry, data.damage);
+                    // Show as much of the title as fits into the titlebar.
+                    auto size = title_texture.tex->texture.get_size();
+                    const double scale = data.target.scale;
+                    const double shown_width = std::min<double>(size.width, title_geometry.width * scale);
+                    tex.source_box = wlr_fbox{0, 0, shown_width, (double)size.height};
+
+                    wlr_fbox title_box = wf::geometry_to_fbox(title_geometry);
+                    title_box.width = shown_width / scale;
+                    data.pass->add_texture(tex, data.target, title_box, data.damage);
                 }
             } else // button
             {
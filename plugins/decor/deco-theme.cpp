@@ -2,6 +2,7 @@
 #include <wayfire/core.hpp>
 #include <wayfire/opengl.hpp>
 #include <config.h>
+#include <algorithm>
 
 namespace wf
 {
@@ -44,6 +45,25 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
     data.pass->add_rect(color, data.target, rectangle, data.damage);
 }
 
+PangoLayout*decoration_theme_t::create_title_layout(cairo_t *cr, const std::string& text,
+    int height) const
+{
+    const float font_scale = 0.8;
+    const float font_size  = height * font_scale;
+
+    PangoFontDescription *font_desc;
+    PangoLayout *layout;
+
+    font_desc = pango_font_description_from_string(((std::string)font).c_str());
+    pango_font_description_set_absolute_size(font_desc, font_size * PANGO_SCALE);
+
+    layout = pango_cairo_create_layout(cr);
+    pango_layout_set_font_description(layout, font_desc);
+    pango_layout_set_text(layout, text.c_str(), text.size());
+    pango_font_description_free(font_desc);
+    return layout;
+}
+
 /**
  * Render the given text on a cairo_surface_t with the given size.
  * The caller is responsible for freeing the memory afterwards.
@@ -62,28 +82,60 @@ cairo_surface_t*decoration_theme_t::render_text(std::string text,
     wf::color_t color = font_color;
     auto cr = cairo_create(surface);
 
-    const float font_scale = 0.8;
-    const float font_size  = height * font_scale;
-
-    PangoFontDescription *font_desc;
-    PangoLayout *layout;
-
     // render text
-    font_desc = pango_font_description_from_string(((std::string)font).c_str());
-    pango_font_description_set_absolute_size(font_desc, font_size * PANGO_SCALE);
-
-    layout = pango_cairo_create_layout(cr);
-    pango_layout_set_font_description(layout, font_desc);
-    pango_layout_set_text(layout, text.c_str(), text.size());
+    auto layout = create_title_layout(cr, text, height);
     cairo_set_source_rgba(cr, color.r, color.g, color.b, color.a);
     pango_cairo_show_layout(cr, layout);
-    pango_font_description_free(font_desc);
     g_object_unref(layout);
     cairo_destroy(cr);
 
     return surface;
 }
 
+std::shared_ptr<const wf::cached_text_t> decoration_theme_t::render_title(wf::text_cache_t& cache,
+    const std::string& text, int height, int max_width) const
+{
+    wf::color_t color = font_color;
+    auto make_key = [&] (int width)
+    {
+        return "decoration-title:" + (std::string)font + ":" +
+               std::to_string(color.r) + "," + std::to_string(color.g) + "," +
+               std::to_string(color.b) + "," + std::to_string(color.a) + ":" +
+               std::to_string(height) + ":" + std::to_string(width) + ":" + text;
+    };
+
+    auto fits = [&] (wf::dimensions_t needed)
+    {
+        return needed.width <= max_width;
+    };
+
+    return cache.get_natural_or_cropped(make_key(0), make_key(max_width), fits, [&]
+    {
+        auto result = std::make_shared<wf::cached_text_t>();
+        if (height <= 0)
+        {
+            return result;
+        }
+
+        // Measure the text first, so that the surface is only as wide as needed.
+        auto measure_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+        auto cr     = cairo_create(measure_surface);
+        auto layout = create_title_layout(cr, text, height);
+        PangoRectangle extents;
+        pango_layout_get_pixel_extents(layout, NULL, &extents);
+        g_object_unref(layout);
+        cairo_destroy(cr);
+        cairo_surface_destroy(measure_surface);
+
+        const int text_width = std::max(0, extents.x + extents.width);
+        auto surface = render_text(text, std::min(text_width, max_width), height);
+        result->texture     = wf::owned_texture_t{surface};
+        result->needed_size = {text_width, height};
+        cairo_surface_destroy(surface);
+        return result;
+    });
+}
+
 cairo_surface_t*decoration_theme_t::get_button_surface(button_type_t button,
     const button_state_t& state) const
 {
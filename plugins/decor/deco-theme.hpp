@@ -1,6 +1,7 @@
 #pragma once
 #include <wayfire/render-manager.hpp>
 #include <wayfire/scene-render.hpp>
+#include <wayfire/plugins/common/text-cache.hpp>
 #include "deco-button.hpp"
 
 namespace wf
@@ -41,6 +42,18 @@ class decoration_theme_t
      */
     cairo_surface_t *render_text(std::string text, int width, int height) const;
 
+    /**
+     * Get the title rendered at its natural width, but at most @max_width
+     * pixels wide, from the text cache. The title is rendered and uploaded
+     * only if it is not in the cache yet.
+     *
+     * The needed_size of the result is the full size of the text, so the
+     * title was truncated if it is wider than the texture. Titles which fit
+     * are shared by all values of @max_width.
+     */
+    std::shared_ptr<const wf::cached_text_t> render_title(wf::text_cache_t& cache,
+        const std::string& text, int height, int max_width) const;
+
     struct button_state_t
     {
         /** Button width */
@@ -65,6 +78,9 @@ class decoration_theme_t
         const button_state_t& state) const;
 
   private:
+    /** Create a layout of the title text for the given titlebar height. */
+    PangoLayout *create_title_layout(cairo_t *cr, const std::string& text, int height) const;
+
     wf::option_wrapper_t<std::string> font{"decoration/font"};
     wf::option_wrapper_t<wf::color_t> font_color{"decoration/font_color"};
     wf::option_wrapper_t<int> title_height{"decoration/title_height"};
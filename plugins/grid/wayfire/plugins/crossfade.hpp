@@ -50,6 +50,7 @@ class crossfade_node_t : public scene::view_2d_transformer_t
         const wf::geometry_t bbox = root_node->get_bounding_box();
         const wf::geometry_t g    = view->get_geometry();
         const float scale = view->get_output()->handle->scale;
+        original_buffer.set_owner("grid: crossfade snapshot of " + view->to_string());
         original_buffer.allocate(wf::dimensions(g), scale);
 
         wf::render_target_t target{original_buffer};
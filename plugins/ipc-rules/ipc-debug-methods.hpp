@@ -0,0 +1,275 @@
+#pragma once
+#include "ipc-rules-common.hpp"
+#include "wayfire/plugins/ipc/ipc-helpers.hpp"
+#include "wayfire/plugins/ipc/ipc-method-repository.hpp"
+#include "wayfire/core.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/trace.hpp>
+#include <algorithm>
+#include <sstream>
+
+namespace wf
+{
+/**
+ * IPC methods which expose internal state of the compositor useful for debugging and profiling.
+ */
+class ipc_rules_debug_methods_t
+{
+  public:
+    void init_debug_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->register_method("wayfire/frame-timeline", get_frame_timeline);
+        method_repository->register_method("wayfire/hook-timings", get_hook_timings);
+        method_repository->register_method("wayfire/memory-report", get_memory_report);
+        method_repository->register_method("wayfire/trace/enable", enable_trace);
+        method_repository->register_method("wayfire/trace/flush", flush_trace);
+    }
+
+    void fini_debug_methods(ipc::method_repository_t *method_repository)
+    {
+        method_repository->unregister_method("wayfire/frame-timeline");
+        method_repository->unregister_method("wayfire/hook-timings");
+        method_repository->unregister_method("wayfire/memory-report");
+        method_repository->unregister_method("wayfire/trace/enable");
+        method_repository->unregister_method("wayfire/trace/flush");
+    }
+
+    static std::string frame_phase_to_string(frame_phase_t phase)
+    {
+        switch (phase)
+        {
+          case FRAME_PHASE_PRE_EFFECTS:
+            return "pre-effects";
+
+          case FRAME_PHASE_DAMAGE_EFFECTS:
+            return "damage-effects";
+
+          case FRAME_PHASE_SCANOUT:
+            return "scanout";
+
+          case FRAME_PHASE_START_FRAME:
+            return "start-frame";
+
+          case FRAME_PHASE_RENDER_PASS:
+            return "render-pass";
+
+          case FRAME_PHASE_OVERLAY:
+            return "overlay";
+
+          case FRAME_PHASE_SUBMIT:
+            return "submit";
+
+          case FRAME_PHASE_POSTPROCESS:
+            return "postprocess";
+
+          case FRAME_PHASE_SW_CURSORS:
+            return "sw-cursors";
+
+          case FRAME_PHASE_SWAP:
+            return "swap";
+
+          case FRAME_PHASE_POST_PAINT:
+            return "post-paint";
+
+          default:
+            return "unknown";
+        }
+    }
+
+    static std::string frame_result_to_string(frame_result_t result)
+    {
+        switch (result)
+        {
+          case frame_result_t::RENDERED:
+            return "rendered";
+
+          case frame_result_t::SCANOUT:
+            return "scanout";
+
+          case frame_result_t::SKIPPED:
+            return "skipped";
+
+          case frame_result_t::FAILED:
+            return "failed";
+        }
+
+        return "unknown";
+    }
+
+    static wf::json_t frame_timing_to_json(const frame_timing_t& frame)
+    {
+        wf::json_t data;
+        data["seq"] = frame.seq;
+        data["frame-event"] = frame.frame_event;
+        data["start"]  = frame.start;
+        data["result"] = frame_result_to_string(frame.result);
+        data["culled-instructions"] = frame.culled_instructions;
+        data["instance-regens"]   = frame.instance_regens;
+        data["regenerated-nodes"] = frame.regenerated_nodes;
+        data["regen-time"] = frame.regen_time;
+
+        // For each phase which was reached, report when it ended and how long it took.
+        wf::json_t phases = wf::json_t::array();
+        int64_t last_end  = frame.start;
+        for (int i = 0; i < FRAME_PHASE_TOTAL; i++)
+        {
+            if (frame.phase_end[i] < 0)
+            {
+                continue;
+            }
+
+            wf::json_t phase;
+            phase["name"]     = frame_phase_to_string((frame_phase_t)i);
+            phase["end"]      = frame.phase_end[i];
+            phase["duration"] = frame.phase_end[i] - last_end;
+            phases.append(phase);
+            last_end = frame.phase_end[i];
+        }
+
+        data["phases"] = phases;
+        data["commit-seq"] = frame.commit_seq;
+        data["presented"]  = frame.presented;
+        data["discarded"]  = frame.discarded;
+        data["refresh-nsec"] = frame.refresh_nsec;
+        return data;
+    }
+
+    static wf::json_t output_timeline_to_json(wf::output_t *output)
+    {
+        wf::json_t data;
+        data["output"]    = output->to_string();
+        data["output-id"] = output->get_id();
+
+        wf::json_t frames = wf::json_t::array();
+        for (auto& frame : output->render->get_frame_timeline())
+        {
+            frames.append(frame_timing_to_json(frame));
+        }
+
+        data["frames"] = frames;
+        return data;
+    }
+
+    static wf::json_t output_hook_timings_to_json(wf::output_t *output)
+    {
+        wf::json_t data;
+        data["output"]    = output->to_string();
+        data["output-id"] = output->get_id();
+        data["quality-reduction"] = output->render->get_quality_reduction();
+
+        wf::json_t hooks = wf::json_t::array();
+        for (auto& timing : output->render->get_hook_timings())
+        {
+            wf::json_t hook;
+            std::ostringstream address;
+            address << timing.hook;
+            hook["hook"]    = address.str();
+            hook["name"]    = timing.name;
+            hook["type"]    = output_effect_type_to_string(timing.type);
+            hook["calls"]   = timing.calls;
+            hook["last"]    = timing.last;
+            hook["average"] = timing.average;
+            hook["max"] = timing.max;
+            hooks.append(hook);
+        }
+
+        data["hooks"] = hooks;
+        return data;
+    }
+
+    /**
+     * Run @to_json for the output given by the optional "output-id" field of @data, or for all outputs.
+     */
+    static wf::json_t collect_outputs(const wf::json_t& data,
+        std::function<wf::json_t(wf::output_t*)> to_json)
+    {
+        auto output_id = wf::ipc::json_get_optional_uint64(data, "output-id");
+
+        wf::json_t outputs = wf::json_t::array();
+        if (output_id.has_value())
+        {
+            auto wo = wf::ipc::find_output_by_id(output_id.value());
+            if (!wo)
+            {
+                return wf::ipc::json_error("Output not found!");
+            }
+
+            outputs.append(to_json(wo));
+        } else
+        {
+            for (auto& wo : wf::get_core().output_layout->get_outputs())
+            {
+                outputs.append(to_json(wo));
+            }
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["outputs"] = outputs;
+        return response;
+    }
+
+    wf::ipc::method_callback get_frame_timeline = [=] (const wf::json_t& data) -> json_t
+    {
+        return collect_outputs(data, output_timeline_to_json);
+    };
+
+    wf::ipc::method_callback get_hook_timings = [=] (const wf::json_t& data) -> json_t
+    {
+        return collect_outputs(data, output_hook_timings_to_json);
+    };
+
+    wf::ipc::method_callback get_memory_report = [=] (const wf::json_t&) -> json_t
+    {
+        auto usage = wf::get_buffer_memory_usage();
+        std::sort(usage.begin(), usage.end(), [] (const auto& a, const auto& b)
+        {
+            return a.live_bytes > b.live_bytes;
+        });
+
+        uint64_t total_live = 0;
+        wf::json_t owners   = wf::json_t::array();
+        for (auto& owner : usage)
+        {
+            wf::json_t data;
+            data["owner"] = owner.owner;
+            data["live-bytes"]  = (uint64_t)owner.live_bytes;
+            data["peak-bytes"]  = (uint64_t)owner.peak_bytes;
+            data["buffers"]     = (uint64_t)owner.buffers;
+            data["allocations"] = owner.allocations;
+            owners.append(data);
+            total_live += owner.live_bytes;
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["live-bytes"] = total_live;
+        response["owners"] = owners;
+        return response;
+    };
+
+    wf::ipc::method_callback enable_trace = [=] (const wf::json_t& data) -> json_t
+    {
+        auto enabled = wf::ipc::json_get_optional_bool(data, "enabled");
+        wf::trace::set_enabled(enabled.value_or(true));
+        return wf::ipc::json_ok();
+    };
+
+    wf::ipc::method_callback flush_trace = [=] (const wf::json_t& data) -> json_t
+    {
+        // The trace is always written to the default path. Clients must not be able to make the compositor
+        // overwrite arbitrary files.
+        const auto path = wf::trace::get_default_path();
+        const int64_t events = wf::trace::flush(path);
+        if (events < 0)
+        {
+            return wf::ipc::json_error("Failed to write trace to " + path);
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["path"]   = path;
+        response["events"] = events;
+        return response;
+    };
+};
+}
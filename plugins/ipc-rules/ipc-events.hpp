@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ipc-rules-common.hpp"
+#include "ipc-debug-methods.hpp"
 #include <set>
 #include "wayfire/output-layout.hpp"
 #include "wayfire/plugins/ipc/ipc-method-repository.hpp"
@@ -133,6 +134,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         {"view-workspace-changed", get_generic_output_registration_cb(&_view_workspace)},
         {"output-wset-changed", get_generic_output_registration_cb(&on_wset_changed)},
         {"wset-workspace-changed", get_generic_output_registration_cb(&on_wset_workspace_changed)},
+        {"output-frame-stall", get_generic_output_registration_cb(&on_frame_stall)},
     };
 
     // Track a list of clients which have requested watch
@@ -431,5 +433,33 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
             ev->output ? wset_to_json(ev->output->wset().get()) : json_t::null();
         send_event_to_subscribes(data, data["event"]);
     };
+
+    static wf::json_t stall_entries_to_json(const std::vector<wf::frame_stall_entry_t>& entries)
+    {
+        wf::json_t list = wf::json_t::array();
+        for (auto& entry : entries)
+        {
+            wf::json_t item;
+            item["name"]     = entry.name;
+            item["stage"]    = entry.stage;
+            item["duration"] = entry.duration;
+            list.append(item);
+        }
+
+        return list;
+    }
+
+    wf::signal::connection_t<wf::output_frame_stall_signal> on_frame_stall =
+        [=] (wf::output_frame_stall_signal *ev)
+    {
+        wf::json_t data;
+        data["event"]  = "output-frame-stall";
+        data["output"] = (int)ev->output->get_id();
+        data["frame"]  = ipc_rules_debug_methods_t::frame_timing_to_json(ev->frame);
+        data["instances"] = stall_entries_to_json(ev->report.instances);
+        data["hooks"]  = stall_entries_to_json(ev->report.hooks);
+        data["passes"] = stall_entries_to_json(ev->report.passes);
+        send_event_to_subscribes(data, data["event"]);
+    };
 };
 }
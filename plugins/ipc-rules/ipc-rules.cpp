@@ -15,11 +15,13 @@
 #include "ipc-rules-common.hpp"
 #include "ipc-input-methods.hpp"
 #include "ipc-utility-methods.hpp"
+#include "ipc-debug-methods.hpp"
 #include "ipc-events.hpp"
 
 class ipc_rules_t : public wf::plugin_interface_t,
     public wf::ipc_rules_input_methods_t,
     public wf::ipc_rules_utility_methods_t,
+    public wf::ipc_rules_debug_methods_t,
     public wf::ipc_rules_events_methods_t
 {
   public:
@@ -40,6 +42,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
 
         init_input_methods(method_repository.get());
         init_utility_methods(method_repository.get());
+        init_debug_methods(method_repository.get());
         init_events(method_repository.get());
     }
 
@@ -60,6 +63,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
 
         fini_input_methods(method_repository.get());
         fini_utility_methods(method_repository.get());
+        fini_debug_methods(method_repository.get());
         fini_events(method_repository.get());
     }
 
@@ -4,6 +4,7 @@
 #include <map>
 #include "wayfire/signal-provider.hpp"
 #include <wayfire/nonstd/json.hpp>
+#include <wayfire/trace.hpp>
 #include <string>
 
 namespace wf
@@ -99,6 +100,7 @@ class method_repository_t : public wf::signal::provider_t
     {
         if (this->methods.count(method))
         {
+            TRACE_SCOPE(IPC, method);
             try {
                 return this->methods[method](std::move(data), client);
             } catch (const ipc_method_exception_t& e)
@@ -14,6 +14,7 @@
 #include <wayfire/opengl.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
+#include <wayfire/plugins/common/text-cache.hpp>
 #include <wayfire/scene.hpp>
 #include <wayfire/scene-render.hpp>
 
@@ -23,7 +24,8 @@
 struct view_title_texture_t : public wf::custom_data_t
 {
     wayfire_toplevel_view view;
-    wf::cairo_text_t overlay;
+    wf::shared_data::ref_ptr_t<wf::text_cache_t> text_cache;
+    std::shared_ptr<const wf::cached_text_t> overlay;
     wf::cairo_text_t::params par;
     bool overflow = false;
     wayfire_toplevel_view dialog; /* the texture should be rendered on top of this dialog */
@@ -40,8 +42,18 @@ struct view_title_texture_t : public wf::custom_data_t
 
     void update_overlay_texture()
     {
-        auto res = overlay.render_text(view->get_title(), par);
-        overflow = res.width > overlay.get_size().width;
+        overlay  = wf::render_text_cached(*text_cache.get(), view->get_title(), par);
+        overflow = overlay->needed_size.width > get_size().width;
+    }
+
+    wf::texture_t get_texture() const
+    {
+        return overlay ? overlay->texture.get_texture() : wf::texture_t{};
+    }
+
+    wf::dimensions_t get_size() const
+    {
+        return overlay ? overlay->texture.get_size() : wf::dimensions_t{0, 0};
     }
 
     wf::signal::connection_t<wf::view_title_changed_signal> view_changed_title =
@@ -198,18 +210,18 @@ class title_overlay_node_t : public node_t
          * animated and maybe redraw less frequently
          */
         auto& tex = get_overlay_texture(find_topmost_parent(view));
-        if ((tex.overlay.get_texture().texture == nullptr) ||
+        if ((tex.get_texture().texture == nullptr) ||
             (output_scale != tex.par.output_scale) ||
-            (tex.overlay.get_size().width > box.width * output_scale) ||
+            (tex.get_size().width > box.width * output_scale) ||
             (tex.overflow &&
-             (tex.overlay.get_size().width < std::floor(box.width * output_scale))))
+             (tex.get_size().width < std::floor(box.width * output_scale))))
         {
             tex.par.output_scale = output_scale;
             tex.update_overlay_texture({box.width, box.height});
         }
 
-        geometry.width  = tex.overlay.get_size().width / output_scale;
-        geometry.height = tex.overlay.get_size().height / output_scale;
+        geometry.width  = tex.get_size().width / output_scale;
+        geometry.height = tex.get_size().height / output_scale;
 
         auto bbox = get_scaled_bbox(view);
         geometry.x = bbox.x + bbox.width / 2 - geometry.width / 2;
@@ -240,10 +252,10 @@ class title_overlay_node_t : public node_t
         auto parent = find_topmost_parent(view);
         auto& title = get_overlay_texture(parent);
 
-        if (title.overlay.get_texture().texture != nullptr)
+        if (title.get_texture().texture != nullptr)
         {
             text_height = (unsigned int)std::ceil(
-                title.overlay.get_size().height / title.par.output_scale);
+                title.get_size().height / title.par.output_scale);
         } else
         {
             text_height =
@@ -323,13 +335,13 @@ class title_overlay_render_instance_t : public render_instance_t
         auto tr     = self->view->get_transformed_node()
             ->get_transformer<wf::scene::view_2d_transformer_t>("scale");
 
-        if (!title.overlay.get_texture().texture)
+        if (!title.get_texture().texture)
         {
             /* this should not happen */
             return;
         }
 
-        data.pass->add_texture(title.overlay.get_texture(), data.target, self->geometry, data.damage,
+        data.pass->add_texture(title.get_texture(), data.target, self->geometry, data.damage,
             tr->alpha);
 
         self->idle_update_title.run_once();
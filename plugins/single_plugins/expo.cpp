@@ -43,6 +43,8 @@ class wayfire_expo : public wf::per_output_plugin_instance_t, public wf::keyboar
     wf::option_wrapper_t<bool> keyboard_interaction{"expo/keyboard_interaction"};
     wf::option_wrapper_t<double> inactive_brightness{"expo/inactive_brightness"};
     wf::option_wrapper_t<int> transition_length{"expo/transition_length"};
+    wf::option_wrapper_t<bool> warm_thumbnails{"expo/warm_thumbnails"};
+    wf::option_wrapper_t<int> warm_thumbnails_interval{"expo/warm_thumbnails_interval"};
     wf::geometry_animation_t zoom_animation{zoom_duration};
 
     wf::option_wrapper_t<bool> move_enable_snap_off{"move/enable_snap_off"};
@@ -128,12 +130,21 @@ class wayfire_expo : public wf::per_output_plugin_instance_t, public wf::keyboar
 
         setup_workspace_bindings_from_config();
         wall = std::make_unique<wf::workspace_wall_t>(this->output);
+        wall->set_gap_size(this->delimiter_offset);
+        update_warm_thumbnails();
+        warm_thumbnails.set_callback([=] { update_warm_thumbnails(); });
+        warm_thumbnails_interval.set_callback([=] { update_warm_thumbnails(); });
 
         drag_helper->connect(&on_drag_output_focus);
         drag_helper->connect(&on_drag_snap_off);
         drag_helper->connect(&on_drag_done);
     }
 
+    void update_warm_thumbnails()
+    {
+        wall->set_warm_thumbnails(warm_thumbnails, warm_thumbnails_interval);
+    }
+
     bool handle_toggle()
     {
         if (!state.active)
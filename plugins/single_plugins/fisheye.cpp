@@ -27,50 +27,35 @@
 #include <wayfire/opengl.hpp>
 #include <wayfire/util/duration.hpp>
 #include <wayfire/render-manager.hpp>
+#include <cmath>
 
-static const char *vertex_shader =
+static const char *fisheye_declarations =
     R"(
-#version 100
+uniform vec2 fisheye_resolution;
+uniform vec2 fisheye_mouse;
+uniform float fisheye_radius;
+uniform float fisheye_zoom;
 
-attribute highp vec2 position;
-
-void main() {
-
-    gl_Position = vec4(position.xy, 0.0, 1.0);
-}
+const float FISHEYE_PI = 3.1415926535;
 )";
 
-static const char *fragment_shader =
+static const char *fisheye_sample_transform =
     R"(
-#version 100
-precision highp float;
-
-uniform vec2 u_resolution;
-uniform vec2 u_mouse;
-uniform float u_radius;
-uniform float u_zoom;
-uniform sampler2D u_texture;
-
-const float PI = 3.1415926535;
+        float radius = fisheye_radius;
 
-void main()
-{
-        float radius = u_radius;
-
-        float zoom = u_zoom;
-        float pw = 1.0 / u_resolution.x;
-        float ph = 1.0 / u_resolution.y;
+        float zoom = fisheye_zoom;
+        float pw = 1.0 / fisheye_resolution.x;
+        float ph = 1.0 / fisheye_resolution.y;
 
-        vec4 p0 = vec4(u_mouse.x, u_resolution.y - u_mouse.y, 1.0 / radius, 0.0);
-        vec4 p1 = vec4(pw, ph, PI / radius, (zoom - 1.0) * zoom);
-        vec4 p2 = vec4(0, 0, -PI / 2.0, 0.0);
+        vec4 p0 = vec4(fisheye_mouse.x, fisheye_resolution.y - fisheye_mouse.y, 1.0 / radius, 0.0);
+        vec4 p1 = vec4(pw, ph, FISHEYE_PI / radius, (zoom - 1.0) * zoom);
+        vec4 p2 = vec4(0, 0, -FISHEYE_PI / 2.0, 0.0);
 
         vec4 t0, t1, t2, t3;
 
-        vec3 tc = vec3(1.0, 0.0, 0.0);
-        vec2 uv = vec2(gl_FragCoord.x, gl_FragCoord.y);
+        vec2 pos = uv * fisheye_resolution;
 
-        t1 = p0.xyww - vec4(uv, 0.0, 0.0);
+        t1 = p0.xyww - vec4(pos, 0.0, 0.0);
         t2.x = t2.y = t2.z = t2.w = 1.0 / sqrt(dot(t1.xyz, t1.xyz));
         t0 = t2 - p0;
 
@@ -81,19 +66,15 @@ void main()
         t3 = t3 * p1.w;
 
         t1 = t2 * t1;
-        t1 = t1 * t3 + vec4(uv, 0.0, 0.0);
+        t1 = t1 * t3 + vec4(pos, 0.0, 0.0);
 
         if (t0.z < 0.0) {
-                t1.x = uv.x;
-                t1.y = uv.y;
+                t1.x = pos.x;
+                t1.y = pos.y;
         }
 
         t1 = t1 * p1 + p2;
-
-        tc = texture2D(u_texture, t1.xy).rgb;
-
-        gl_FragColor = vec4(tc, 1.0);
-}
+        return t1.xy;
 )";
 
 class wayfire_fisheye : public wf::per_output_plugin_instance_t
@@ -106,8 +87,6 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
     wf::option_wrapper_t<double> radius{"fisheye/radius"};
     wf::option_wrapper_t<double> zoom{"fisheye/zoom"};
 
-    OpenGL::program_t program;
-
     wf::plugin_activation_data_t grab_interface = {
         .name = "fisheye",
         .capabilities = 0,
@@ -124,10 +103,12 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
             return;
         }
 
-        wf::gles::run_in_context_if_gles([&]
+        effect.declarations     = fisheye_declarations;
+        effect.sample_transform = fisheye_sample_transform;
+        effect.set_uniforms     = [=] (OpenGL::program_t& program, wf::dimensions_t size)
         {
-            program.set_simple(OpenGL::compile_program(vertex_shader, fragment_shader));
-        });
+            set_uniforms(program, size);
+        };
 
         hook_set = active = false;
         output->add_activator(wf::option_wrapper_t<wf::activatorbinding_t>{"fisheye/toggle"}, &toggle_cb);
@@ -160,61 +141,63 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
             if (!hook_set)
             {
                 hook_set = true;
-                output->render->add_post(&render_hook);
-                output->render->set_redraw_always();
+                output->render->add_post(&effect, wf::post_effect_dependencies_t{
+                    .pointer   = true,
+                    .animating = [=] () { return progression.running(); },
+                    .transform_damage = [=] (const wf::region_t& damage) { return transform_damage(damage); },
+                });
             }
         }
 
         return true;
     };
 
-    wf::post_hook_t render_hook = [=] (wf::auxilliary_buffer_t& source,
-                                       const wf::render_buffer_t& dest)
+    wf::fusible_post_effect_t effect;
+
+    /* The lens on the last frame, in buffer-local coordinates */
+    wf::geometry_t last_lens = {0, 0, 0, 0};
+
+    /**
+     * Pixels outside of the lens are not changed, and pixels inside the lens sample only from inside it.
+     */
+    wf::region_t transform_damage(const wf::region_t& damage)
+    {
+        wf::region_t result = damage;
+        if (!(damage & last_lens).empty())
+        {
+            result |= last_lens;
+        }
+
+        return result;
+    }
+
+    void set_uniforms(OpenGL::program_t& program, wf::dimensions_t size)
     {
         auto oc     = output->get_cursor_position();
         wlr_box box = {(int)oc.x, (int)oc.y, 1, 1};
         box = output->render->get_target_framebuffer().
             framebuffer_box_from_geometry_box(box);
-        oc.x = box.x;
-        oc.y = box.y;
-
-        static const float vertexData[] = {
-            -1.0f, -1.0f,
-            1.0f, -1.0f,
-            1.0f, 1.0f,
-            -1.0f, 1.0f
-        };
-
-        wf::gles::run_in_context_if_gles([&]
-        {
-            wf::gles::bind_render_buffer(dest);
-            program.use(wf::TEXTURE_TYPE_RGBA);
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, wf::gles_texture_t::from_aux(source).tex_id));
-            GL_CALL(glActiveTexture(GL_TEXTURE0));
-
-            program.uniform2f("u_mouse", oc.x, oc.y);
-            program.uniform2f("u_resolution", dest.get_size().width, dest.get_size().height);
-            program.uniform1f("u_radius", radius);
-            program.uniform1f("u_zoom", progression);
 
-            program.attrib_pointer("position", 2, 0, vertexData);
+        // Pixels inside the lens are displaced by at most (zoom - 1) * zoom, so they may sample slightly
+        // outside of it.
+        const double displacement = std::abs(((double)progression - 1) * (double)progression);
+        const int lens_radius     = std::ceil((double)radius + displacement);
+        last_lens = {box.x - lens_radius, box.y - lens_radius, 2 * lens_radius, 2 * lens_radius};
 
-            GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-
-            program.deactivate();
-        });
+        program.uniform2f("fisheye_mouse", box.x, box.y);
+        program.uniform2f("fisheye_resolution", size.width, size.height);
+        program.uniform1f("fisheye_radius", radius);
+        program.uniform1f("fisheye_zoom", progression);
 
         if (!active && !progression.running())
         {
             finalize();
         }
-    };
+    }
 
     void finalize()
     {
-        output->render->rem_post(&render_hook);
-        output->render->set_redraw_always(false);
+        output->render->rem_post(&effect);
         hook_set = false;
     }
 
@@ -225,11 +208,6 @@ class wayfire_fisheye : public wf::per_output_plugin_instance_t
             finalize();
         }
 
-        wf::gles::run_in_context_if_gles([&]
-        {
-            program.free_resources();
-        });
-
         output->rem_binding(&toggle_cb);
     }
 };
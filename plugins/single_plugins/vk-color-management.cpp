@@ -20,7 +20,10 @@ class wayfire_passthrough_screen : public wf::per_output_plugin_instance_t
             return;
         }
 
-        output->render->add_post(&render_hook);
+        // The color transform is applied per pixel, so damage stays the same.
+        output->render->add_post(&render_hook, wf::post_effect_dependencies_t{
+            .transform_damage = [] (const wf::region_t& damage) { return damage; },
+        });
 
         vk_renderer = wlr_vk_renderer_create_with_drm_fd(wlr_renderer_get_drm_fd(wf::get_core().renderer));
     }
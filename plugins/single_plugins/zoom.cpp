@@ -3,6 +3,7 @@
 #include <wayfire/render.hpp>
 #include <wayfire/render-manager.hpp>
 #include <wayfire/util/duration.hpp>
+#include <cmath>
 
 class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
 {
@@ -19,6 +20,10 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
     wf::animation::simple_animation_t progression{smoothing_duration};
     bool hook_set = false;
 
+    /* The part of the source buffer which was shown on the last frame, and the size of the destination */
+    wlr_fbox last_source = {0, 0, 0, 0};
+    wf::dimensions_t last_size = {0, 0};
+
     wf::plugin_activation_data_t grab_interface = {
         .name = "zoom",
         .capabilities = 0,
@@ -44,8 +49,11 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
             if (!hook_set)
             {
                 hook_set = true;
-                output->render->add_post(&render_hook);
-                output->render->set_redraw_always();
+                output->render->add_post(&render_hook, wf::post_effect_dependencies_t{
+                    .pointer   = true,
+                    .animating = [=] () { return progression.running(); },
+                    .transform_damage = [=] (const wf::region_t& damage) { return transform_damage(damage); },
+                });
             }
         }
     }
@@ -93,16 +101,45 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         const float th     = std::clamp(h / factor, 0.0f, h - y1);
         auto filter_mode   = (interpolation_method == (int)interpolation_method_t::NEAREST) ?
             WLR_SCALE_FILTER_NEAREST : WLR_SCALE_FILTER_BILINEAR;
-        destination.blit(source, {x1, y1, tw, th}, {0, 0, w, h}, filter_mode);
+        last_source = {x1, y1, tw, th};
+        last_size   = {w, h};
+        destination.blit(source, last_source, {0, 0, w, h}, filter_mode);
         if (!progression.running() && (progression - 1 <= 0.01))
         {
             unset_hook();
         }
     };
 
+    /**
+     * Map damage on the source buffer to the zoomed-in destination buffer.
+     */
+    wf::region_t transform_damage(const wf::region_t& damage)
+    {
+        if ((last_source.width <= 0) || (last_source.height <= 0))
+        {
+            return wf::region_t{wlr_box{0, 0, last_size.width, last_size.height}};
+        }
+
+        const double scale_x = last_size.width / last_source.width;
+        const double scale_y = last_size.height / last_source.height;
+
+        wf::region_t result;
+        for (const auto& box : damage)
+        {
+            const int x1 = std::floor((box.x1 - last_source.x) * scale_x);
+            const int y1 = std::floor((box.y1 - last_source.y) * scale_y);
+            const int x2 = std::ceil((box.x2 - last_source.x) * scale_x);
+            const int y2 = std::ceil((box.y2 - last_source.y) * scale_y);
+            result |= wlr_box{x1, y1, x2 - x1, y2 - y1};
+        }
+
+        // Bilinear filtering may sample neighbouring pixels.
+        result.expand_edges(std::ceil(std::max(scale_x, scale_y)));
+        return result;
+    }
+
     void unset_hook()
     {
-        output->render->set_redraw_always(false);
         output->render->rem_post(&render_hook);
         hook_set = false;
     }
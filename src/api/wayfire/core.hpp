@@ -21,6 +21,7 @@ class toplevel_view_interface_t;
 class window_manager_t;
 class workspace_set_t;
 class config_backend_t;
+class thread_pool_t;
 
 namespace scene
 {
@@ -158,6 +159,12 @@ class compositor_core_t : public wf::object_base_t, public signal::provider_t
     std::unique_ptr<wf::txn::transaction_manager_t> tx_manager;
     std::unique_ptr<wf::window_manager_t> default_wm;
 
+    /**
+     * Worker threads for CPU-heavy work, see wayfire/thread-pool.hpp. The number of workers is set by the
+     * core/worker_threads option at startup.
+     */
+    std::unique_ptr<wf::thread_pool_t> thread_pool;
+
     /**
      * Various protocols supported by wlroots
      */
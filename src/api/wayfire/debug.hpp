@@ -15,6 +15,7 @@
 #include <wayfire/scene.hpp>
 #include <wayfire/core.hpp>
 #include <bitset>
+#include <string_view>
 
 namespace wf
 {
@@ -69,10 +70,17 @@ enum class logging_category : size_t
     INPUT_DEVICES = 12,
     // Output-device-related events
     OUTPUT        = 13,
+    // IPC method calls
+    IPC           = 14,
     TOTAL,
 };
 
 extern std::bitset<(size_t)logging_category::TOTAL> enabled_categories;
+
+/**
+ * Get the name of a logging category, as used on the command line.
+ */
+std::string_view get_category_name(logging_category category);
 }
 }
 
@@ -12,6 +12,8 @@ struct region_t
     /* Makes a copy of the given region */
     region_t(const pixman_region32_t *damage);
     region_t(const wlr_box& box);
+    /* Creates the union of the given (possibly overlapping) boxes */
+    region_t(const pixman_box32_t *boxes, int count);
     ~region_t();
 
     region_t(const region_t& other);
@@ -24,8 +26,24 @@ struct region_t
     void clear();
 
     void expand_edges(int amount);
+
+    /**
+     * Replace groups of rectangles with their bounding box, as long as the
+     * bounding box is at most (1 + max_overdraw) times larger than the area
+     * of the rectangles it replaces. The result always contains the original
+     * region.
+     *
+     * Renderers process damage rectangle by rectangle, so drawing a slightly
+     * larger area is often cheaper than drawing many small rectangles.
+     */
+    void coalesce(double max_overdraw);
+
+    /* The number of rectangles in the region */
+    int size() const;
     pixman_box32_t get_extents() const;
     bool contains_point(const point_t& point) const;
+    /* Check whether the region and the box overlap, without computing the intersection */
+    bool intersects(const wlr_box& box) const;
     bool contains_pointf(const pointf_t& point) const;
 
     /* Translate the region */
@@ -4,6 +4,14 @@
 #include <wayfire/output.hpp>
 #include <wayfire/object.hpp>
 #include <wayfire/region.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace OpenGL
+{
+class program_t;
+}
 
 namespace wf
 {
@@ -35,6 +43,12 @@ enum output_effect_type_t
     OUTPUT_EFFECT_TOTAL     = 5,
 };
 
+/**
+ * @return A short name of the effect type, e.g. "pre", or "postprocess" for OUTPUT_EFFECT_TOTAL (used for
+ *   post effects).
+ */
+const char *output_effect_type_to_string(output_effect_type_t type);
+
 /** Post hooks are called just before swapping buffers. In contrast to
  * render hooks, post hooks operate on the whole output image, i.e they
  * are suitable for different postprocessing effects.
@@ -51,6 +65,96 @@ enum output_effect_type_t
 using post_hook_t = std::function<void (wf::auxilliary_buffer_t& source,
     const wf::render_buffer_t& destination)>;
 
+/**
+ * Describes what the output of a post effect depends on, so that the render manager repaints the output only
+ * when necessary, and only damages the parts of the output which changed.
+ */
+struct post_effect_dependencies_t
+{
+    /**
+     * The output of the effect depends on the pointer position. The output is repainted fully when the pointer
+     * moves.
+     */
+    bool pointer = false;
+
+    /**
+     * If set, the output is repainted fully after each frame for which this returns true, e.g. while an
+     * animation of the effect is running.
+     */
+    std::function<bool ()> animating;
+
+    /**
+     * If set, maps damage of the effect's source buffer to the damage of its destination, both in
+     * buffer-local coordinates, using the parameters from the last time the effect was run. If not set, any
+     * damage causes the whole output to be damaged.
+     */
+    std::function<wf::region_t (const wf::region_t& source_damage)> transform_damage;
+};
+
+/**
+ * A fusible post effect is a post hook which is described by GLSL snippets instead of a callback. Consecutive
+ * fusible effects are compiled into a single shader program and applied in one pass, instead of each effect
+ * reading and writing a full output buffer. Fusible effects are supported only with the GLES renderer.
+ *
+ * The snippets are GLSL ES 1.0 code. All identifiers declared by an effect (uniforms, functions, constants)
+ * need to be unique, so they should be prefixed with the name of the plugin. The snippets must not change
+ * while the effect is added to an output.
+ */
+struct fusible_post_effect_t
+{
+    /** Uniforms and helper functions used by the snippets below. */
+    std::string declarations;
+
+    /**
+     * The body of a function `highp vec2 f(highp vec2 uv)`, which maps a position in the output image to the
+     * position in the source image which should be shown there. Positions are texture coordinates in [0, 1].
+     * Empty if the effect does not move pixels.
+     */
+    std::string sample_transform;
+
+    /**
+     * The body of a function `highp vec4 f(highp vec4 color)`, which transforms the color of a pixel. Empty if
+     * the effect does not change colors.
+     */
+    std::string color_transform;
+
+    /**
+     * Called each frame while the fused program is in use, to set the uniforms of the effect.
+     *
+     * @param size The size of the destination buffer in pixels.
+     */
+    std::function<void (OpenGL::program_t& program, wf::dimensions_t size)> set_uniforms;
+};
+
+/**
+ * A quality callback is used by plugins to adjust their rendering quality (e.g. number of blur iterations or
+ * level of detail) when the output does not keep up with its frame budget (core/frame_budget).
+ *
+ * @param reduce True if the plugin should reduce its quality by one step, false if it may increase its
+ *   quality by one step again.
+ * @return Whether the quality was changed, false if it is already at its lowest (or highest) level.
+ */
+using quality_callback_t = std::function<bool (bool reduce)>;
+
+/**
+ * Timing information about an effect hook or a post effect.
+ * Times are the CPU time spent in the hook in microseconds, GPU work may complete later.
+ */
+struct hook_timing_t
+{
+    /* The address of the effect_hook_t, post_hook_t or fusible_post_effect_t. */
+    const void *hook = nullptr;
+    /* The name given when adding the hook, by default the name of the plugin which defines it. */
+    std::string name;
+    /* The type of an effect hook, or OUTPUT_EFFECT_TOTAL for post effects. */
+    output_effect_type_t type = OUTPUT_EFFECT_TOTAL;
+    uint64_t calls = 0;
+    int64_t last  = 0;
+    int64_t max   = 0;
+    /* Exponential moving average of the time spent in the hook. */
+    double average = 0;
+};
+
 /**
  * The frame-done signal is emitted on an output when the frame has been completed (regardless of whether new
  * content was painted or not).
@@ -58,6 +162,128 @@ using post_hook_t = std::function<void (wf::auxilliary_buffer_t& source,
 struct frame_done_signal
 {};
 
+/**
+ * The phases of an output repaint cycle, in the order in which they are run.
+ */
+enum frame_phase_t
+{
+    /* OUTPUT_EFFECT_PRE hooks */
+    FRAME_PHASE_PRE_EFFECTS    = 0,
+    /* OUTPUT_EFFECT_DAMAGE hooks */
+    FRAME_PHASE_DAMAGE_EFFECTS = 1,
+    /* Attempt to directly scan out a buffer */
+    FRAME_PHASE_SCANOUT        = 2,
+    /* Acquire a swapchain buffer and accumulate damage */
+    FRAME_PHASE_START_FRAME    = 3,
+    /* Instruction scheduling and rendering of the main render pass */
+    FRAME_PHASE_RENDER_PASS    = 4,
+    /* OUTPUT_EFFECT_OVERLAY hooks */
+    FRAME_PHASE_OVERLAY        = 5,
+    /* Submitting the main render pass */
+    FRAME_PHASE_SUBMIT         = 6,
+    /* OUTPUT_EFFECT_PASS_DONE hooks and post hooks */
+    FRAME_PHASE_POSTPROCESS    = 7,
+    /* Software cursors */
+    FRAME_PHASE_SW_CURSORS     = 8,
+    /* Committing the output state */
+    FRAME_PHASE_SWAP           = 9,
+    /* OUTPUT_EFFECT_POST hooks */
+    FRAME_PHASE_POST_PAINT     = 10,
+    FRAME_PHASE_TOTAL          = 11,
+};
+
+/**
+ * How a repaint cycle of an output ended.
+ */
+enum class frame_result_t
+{
+    /* A new frame was rendered and committed. */
+    RENDERED,
+    /* A client buffer was directly scanned out. */
+    SCANOUT,
+    /* The output did not need a new frame. */
+    SKIPPED,
+    /* Rendering or committing the frame failed. */
+    FAILED,
+};
+
+/**
+ * Timing information about a single repaint cycle of an output.
+ * All timestamps are in microseconds, using CLOCK_MONOTONIC as a base.
+ */
+struct frame_timing_t
+{
+    /* A running counter of the repaint cycles on the output. */
+    uint64_t seq = 0;
+    /* When the frame event from the backend was received. */
+    int64_t frame_event = -1;
+    /* When the repaint cycle started, i.e. after the repaint delay. */
+    int64_t start = -1;
+    /* When each phase ended, or -1 if the phase was not reached. */
+    int64_t phase_end[FRAME_PHASE_TOTAL];
+    frame_result_t result = frame_result_t::SKIPPED;
+    /* The number of render instructions dropped because they were hidden behind opaque content. */
+    uint32_t culled_instructions = 0;
+    /* How many times the render instances of the output's scenegraph were regenerated since the previous
+     * frame, for how many nodes in total, and how long it took in microseconds. */
+    uint32_t instance_regens   = 0;
+    uint32_t regenerated_nodes = 0;
+    int64_t regen_time = 0;
+
+    /* The wlr_output commit sequence number, if a commit was made. */
+    uint32_t commit_seq = 0;
+    /* Presentation time reported by the backend, or -1 if unknown. */
+    int64_t presented = -1;
+    /* Whether the backend reported that the frame was discarded. */
+    bool discarded = false;
+    /* The refresh interval reported by the backend in nanoseconds, 0 if unknown. */
+    int64_t refresh_nsec = 0;
+
+    frame_timing_t()
+    {
+        std::fill(std::begin(phase_end), std::end(phase_end), -1);
+    }
+};
+
+/**
+ * A single expensive operation during a stalled frame.
+ */
+struct frame_stall_entry_t
+{
+    /* A description of what was run, e.g. the stringified node of a render instance. */
+    std::string name;
+    /* What the time was spent on, e.g. "schedule" or "render" for render instances. */
+    std::string stage;
+    /* The CPU time spent, in microseconds. */
+    int64_t duration = 0;
+};
+
+/**
+ * The most expensive operations of a frame which took longer than core/frame_stall_threshold.
+ * Each list is sorted by duration, most expensive first.
+ */
+struct frame_stall_report_t
+{
+    /* Render instances, timed individually when scheduling the top-level instances of a render pass and
+     * when rendering each instruction. */
+    std::vector<frame_stall_entry_t> instances;
+    /* Effect hooks and post effects. */
+    std::vector<frame_stall_entry_t> hooks;
+    /* Render passes, including offscreen passes run by plugins during the frame. */
+    std::vector<frame_stall_entry_t> passes;
+};
+
+/**
+ * on: output
+ * when: After painting a frame took longer than core/frame_stall_threshold.
+ */
+struct output_frame_stall_signal
+{
+    wf::output_t *output;
+    const frame_timing_t& frame;
+    const frame_stall_report_t& report;
+};
+
 /** Render manager
  *
  * Each output has a render manager, which is responsible for all rendering
@@ -81,6 +307,8 @@ class render_manager
      *
      * @param always - Whether to always redraw, regardless of damage. Call
      *        set_redraw_always(false) once for each set_redraw_always(true).
+     *
+     * Post effects should prefer to declare their dependencies with add_post() instead.
      */
     void set_redraw_always(bool always = true);
 
@@ -100,8 +328,10 @@ class render_manager
      * Add a new effect hook.
      * @param hook The hook callback
      * @param type The type of the effect hook
+     * @param name A name for the hook in timing reports. If empty, the name of the plugin which defines
+     *   the hook callback is used.
      */
-    void add_effect(effect_hook_t *hook, output_effect_type_t type);
+    void add_effect(effect_hook_t *hook, output_effect_type_t type, std::string name = "");
     /**
      * Remove an added effect hook. No-op if the hook wasn't really added.
      * @param hook The hook callback to be removed
@@ -112,8 +342,10 @@ class render_manager
      * Add a new post hook.
      *
      * @param hook The hook callback
+     * @param dependencies What the output of the hook depends on.
+     * @param name A name for the hook in timing reports, see add_effect().
      */
-    void add_post(post_hook_t *hook);
+    void add_post(post_hook_t *hook, post_effect_dependencies_t dependencies = {}, std::string name = "");
 
     /**
      * Remove a post hook. No-op if hook isn't active.
@@ -122,6 +354,25 @@ class render_manager
      */
     void rem_post(post_hook_t *hook);
 
+    /**
+     * Add a new fusible post effect. It is run in the same order as post hooks, but consecutive fusible effects
+     * are applied in a single pass.
+     *
+     * @param effect The effect to add.
+     * @param dependencies What the output of the effect depends on. Effects without a sample transform
+     *   map damage to itself by default.
+     * @param name A name for the effect in timing reports, see add_effect().
+     */
+    void add_post(fusible_post_effect_t *effect, post_effect_dependencies_t dependencies = {},
+        std::string name = "");
+
+    /**
+     * Remove a fusible post effect. No-op if the effect isn't active.
+     *
+     * @param effect The effect to be removed.
+     */
+    void rem_post(fusible_post_effect_t *effect);
+
     /**
      * @return The damaged region on the current output for the current
      * frame that is used when swapping buffers. This function should
@@ -194,6 +445,35 @@ class render_manager
      */
     void set_require_depth_buffer(bool require);
 
+    /**
+     * Add a callback which is called to reduce rendering quality when painting the output repeatedly takes
+     * longer than the frame budget, and to increase it again when there is enough headroom.
+     */
+    void add_quality_callback(quality_callback_t *callback);
+
+    /**
+     * Remove a quality callback. No-op if the callback was not added.
+     */
+    void rem_quality_callback(quality_callback_t *callback);
+
+    /**
+     * @return The number of steps by which plugins were asked to reduce their quality, and not asked to
+     *   increase it again yet.
+     */
+    int get_quality_reduction() const;
+
+    /**
+     * @return Timing information about the currently registered effect hooks and post effects. Fusible post
+     *   effects which were applied in the same pass each report the time of the whole pass.
+     */
+    std::vector<hook_timing_t> get_hook_timings() const;
+
+    /**
+     * @return Timing information about the most recent repaint cycles on the output, oldest first.
+     *   Only a limited amount of frames is kept.
+     */
+    std::vector<frame_timing_t> get_frame_timeline() const;
+
   public:
     class impl;
     std::unique_ptr<impl> pimpl;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <wayfire/config/types.hpp>
 #include <wayfire/nonstd/wlroots.hpp>
@@ -165,13 +166,46 @@ struct auxilliary_buffer_t
      */
     wlr_texture *get_texture();
 
+    /**
+     * Set the owner of the buffer, used to account for the memory used by buffers (see
+     * get_buffer_memory_usage()). By convention, the owner is the plugin name, followed by a description of
+     * what the buffer is used for, for example the stringified node, like "blur: saved pixels".
+     *
+     * The owner can be changed at any time, including while a buffer is allocated.
+     */
+    void set_owner(const std::string& owner);
+    const std::string& get_owner() const;
+
   private:
     render_buffer_t buffer;
 
     // The wlr_texture creating from this framebuffer.
     wlr_texture *texture = NULL;
+
+    std::string owner = "untagged";
+};
+
+/**
+ * Memory used by the auxilliary buffers of a single owner.
+ */
+struct buffer_memory_usage_t
+{
+    std::string owner;
+    /* Bytes used by the currently allocated buffers, assuming 4 bytes per pixel. */
+    size_t live_bytes = 0;
+    /* The highest value of live_bytes so far. */
+    size_t peak_bytes = 0;
+    /* The number of currently allocated buffers. */
+    size_t buffers = 0;
+    /* The total number of allocations so far. */
+    uint64_t allocations = 0;
 };
 
+/**
+ * Get the memory used by auxilliary buffers, grouped by the buffer owner.
+ */
+std::vector<buffer_memory_usage_t> get_buffer_memory_usage();
+
 /**
  * A render target contains a render buffer and information on how to map
  * coordinates from the logical coordinate space (output-local coordinates, etc.)
@@ -261,6 +295,7 @@ struct render_target_t : public render_buffer_t
 namespace scene
 {
 class render_instance_t;
+struct render_instruction_t;
 using render_instance_uptr = std::unique_ptr<render_instance_t>;
 }
 
@@ -317,6 +352,12 @@ struct render_pass_params_t
      * Flags for this render pass, see @render_pass_flags.
      */
     uint32_t flags = 0;
+
+    /**
+     * If non-negative, the damage of the pass is coalesced with region_t::coalesce() after emitting
+     * render-pass-begin, with the given maximal overdraw.
+     */
+    double damage_coalesce_threshold = -1;
 };
 
 /**
@@ -345,16 +386,18 @@ class render_pass_t
      *
      * The render pass goes as described below:
      *
-     * 1. Optionally, emit render-pass-begin.
-     * 2. Render instructions are generated from the given instances. During this phase, the instances may
+     * 1. The instances expand the damage, see render_instance_t::expand_damage().
+     * 2. Optionally, emit render-pass-begin.
+     * 3. Render instructions are generated from the given instances. During this phase, the instances may
      *    start and execute sub-passes.
-     * 3. The wlroots render pass begins.
-     * 4. Optionally, clear visible background areas with @background_color.
-     * 5. Render instructions are executed back-to-forth.
-     * 6. Optionally, emit render-pass-end.
-     * 7. The wlroots render pass is submitted.
+     * 4. Instructions which are fully hidden behind opaque instructions in front of them are dropped.
+     * 5. The wlroots render pass begins.
+     * 6. Optionally, clear visible background areas with @background_color.
+     * 7. Render instructions are executed back-to-forth.
+     * 8. Optionally, emit render-pass-end.
+     * 9. The wlroots render pass is submitted.
      *
-     * By specifying @flags, steps 1, 4, and 6 can be enabled and disabled.
+     * By specifying @flags, steps 2, 6, and 8 can be enabled and disabled.
      *
      * @return The full damage which was rendered on the render target. It may be more (or
      *  less) than @params.damage because plugins are allowed to modify the
@@ -363,7 +406,7 @@ class render_pass_t
     static wf::region_t run(const wf::render_pass_params_t& params);
 
     /**
-     * Same as @run, but does not submit the wlroots render pass (i.e step 7 is omitted).
+     * Same as @run, but does not submit the wlroots render pass (i.e step 9 is omitted).
      */
     wf::region_t run_partial();
 
@@ -424,6 +467,12 @@ class render_pass_t
      */
     wf::render_target_t get_target() const;
 
+    /**
+     * Get the number of instructions which were dropped by run_partial() because they were hidden behind
+     * opaque instructions in front of them.
+     */
+    uint32_t get_culled_instructions() const;
+
     /**
      * Submit the wlroots render pass.
      * Should only be used after run_partial().
@@ -472,9 +521,13 @@ class render_pass_t
     }
 
   private:
+    uint32_t culled_instructions = 0;
+
     bool prepare_gles_subpass();
     bool prepare_gles_subpass(const wf::render_target_t& target);
     void finish_gles_subpass();
+    void cull_occluded_instructions(std::vector<scene::render_instruction_t>& instructions);
+    void expand_damage(wf::region_t& damage);
 };
 
 
@@ -97,13 +97,21 @@ struct render_instance_manager_t
   private:
     std::vector<node_ptr> nodes;
     std::vector<render_instance_uptr> instances;
+    // The number of instances generated by each node in nodes, in the same order.
+    std::vector<size_t> instance_counts;
     damage_callback on_damage;
     wf::output_t *reference_output;
     std::optional<wf::region_t> visibility_region;
     wf::signal::connection_t<node_update_signal> on_update;
     wf::wl_idle_call idle_visibility;
 
+    // Statistics about instance regeneration, reported in the RENDER log category.
+    uint64_t full_regens    = 0;
+    uint64_t partial_regens = 0;
+    int64_t total_regen_time_us = 0;
+
     void regen_instances();
+    void regen_node_instances(size_t idx);
     void update_visibility();
 };
 }
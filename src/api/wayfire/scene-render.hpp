@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <any>
+#include <string>
 #include <wayfire/config/types.hpp>
 #include <wayfire/region.hpp>
 #include <wayfire/geometry.hpp>
@@ -52,6 +53,13 @@ struct render_instruction_t
     render_target_t target;
     wf::region_t damage;
     std::any data = {};
+    /**
+     * The part of the instruction (in the same coordinate system as the damage) which will be fully
+     * covered by opaque content when the instruction is rendered. Instructions behind it are not rendered
+     * in that region, and instructions which are fully covered are dropped. Instances must therefore not
+     * rely on render() being called for every instruction they schedule.
+     */
+    wf::region_t opaque = {};
 };
 
 /**
@@ -91,6 +99,10 @@ class render_instance_t
      * @param damage The damaged region of the node, in node-local coordinates.
      *   Nodes may subtract from the damage, to prevent rendering below opaque
      *   regions, or expand it for certain special effects like blur.
+     *
+     * Instructions are not retained between render passes: this is called for
+     * every pass, even if the damage and the scenegraph did not change, so
+     * instances may render auxiliary buffers while scheduling.
      */
     virtual void schedule_instructions(
         std::vector<render_instruction_t>& instructions,
@@ -142,6 +154,34 @@ class render_instance_t
      */
     virtual void compute_visibility(wf::output_t *output, wf::region_t& visible)
     {}
+
+    /**
+     * Expand the damage of a render pass before its instructions are scheduled.
+     *
+     * Some instances depend on the pixels around them, for example a blurred background changes when the
+     * content below it changes within the blur radius. Such instances add the parts of themselves which
+     * are affected by the damage, so that the instances in front of them repaint these parts as well.
+     *
+     * Instances which schedule their children in the same render pass (containers, wrappers, transformers
+     * which do not render their children to an auxiliary buffer) must forward the call to them, for example
+     * with expand_damage_from_list(). Otherwise, their children never see the damage of the pass, and for
+     * example a blurred view inside such a container does not update its background when the content
+     * around it changes. There is no fallback for this in the blurred view itself, since it cannot make the
+     * instances in front of it repaint once they have been scheduled. Instances which render their children in a separate render pass
+     * do not need to forward the call, since the sub-pass expands its own damage.
+     *
+     * @param target The render target of the render pass, in the parent's coordinate system.
+     * @param damage The damage of the render pass, in the parent's coordinate system.
+     */
+    virtual void expand_damage(const wf::render_target_t& target, wf::region_t& damage)
+    {}
+
+    /**
+     * A short description of the render instance, used for debugging and profiling.
+     * By default, the name of the instance's type is used, instances which belong to a node should
+     * describe the node instead.
+     */
+    virtual std::string stringify() const;
 };
 
 using damage_callback = std::function<void (const wf::region_t&)>;
@@ -183,6 +223,13 @@ direct_scanout try_scanout_from_list(
 void compute_visibility_from_list(const std::vector<render_instance_uptr>& instances, wf::output_t *output,
     wf::region_t& region, const wf::point_t& offset);
 
+/**
+ * A helper function for expand_damage implementations. It applies an offset to the target and the damage and
+ * reverts it afterwards. It also calls expand_damage for the children instances.
+ */
+void expand_damage_from_list(const std::vector<render_instance_uptr>& instances,
+    const wf::render_target_t& target, wf::region_t& damage, const wf::point_t& offset);
+
 /**
  * A helper class for easier implementation of render instances.
  * It automatically schedules instruction for the current node and tracks damage from the main node.
@@ -202,11 +249,20 @@ class simple_render_instance_t : public render_instance_t
     void schedule_instructions(std::vector<render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
     {
-        instructions.push_back(render_instruction_t{
-                    .instance = this,
-                    .target   = target,
-                    .damage   = damage & self->get_bounding_box(),
-                });
+        auto bbox = self->get_bounding_box();
+        if (damage.intersects(bbox))
+        {
+            instructions.push_back(render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = damage & bbox,
+                    });
+        }
+    }
+
+    std::string stringify() const override
+    {
+        return self->stringify();
     }
 
   protected:
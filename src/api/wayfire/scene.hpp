@@ -439,6 +439,12 @@ class output_node_t : public floating_inner_node_t
     wf::geometry_t get_bounding_box() override;
     std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override;
 
+    /**
+     * Changes to the children of the output node are handled locally by its
+     * render instance, so they do not cause the whole scenegraph to be regenerated.
+     */
+    uint32_t optimize_update(uint32_t flags) override;
+
     /**
      * Get the output this node is responsible for.
      */
@@ -480,6 +486,18 @@ enum class layer : size_t
  *
  * on: scenegraph's root
  * when: Emitted when an update sequence finishes at the scenegraph's root.
+ *
+ * Unlike node_update_signal on the root, the flags always include CHILDREN_LIST and ENABLED if
+ * they were set anywhere in the update sequence, even if a nested node (for example an output)
+ * regenerated its render instances locally and did not propagate them further. Listeners which
+ * need to know whether the root's own render instances have to be regenerated should use
+ * node_update_signal on the root instead.
+ *
+ * The extra flags do not change the result for listeners which check INPUT_STATE or REFOCUS (the
+ * seat, pointer, touch and tablet), since an update with CHILDREN_LIST or ENABLED always carries
+ * INPUT_STATE as well, also after an output has optimized it. Listeners which react to any update
+ * (for example direct scanout promotion) are unaffected too. Listeners which check CHILDREN_LIST
+ * are notified of restacking anywhere in the scenegraph, not only among the root's children.
  */
 struct root_node_update_signal
 {
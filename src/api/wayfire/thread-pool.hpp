@@ -0,0 +1,121 @@
+#pragma once
+
+#include <wayland-server-core.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace wf
+{
+namespace detail
+{
+struct thread_pool_task_t;
+}
+
+/**
+ * A handle to a task submitted to a thread pool.
+ *
+ * The lifetime of the task is tied to the handle: when the handle is destroyed (or reset), the task is
+ * cancelled. If the task has not started yet, it never runs. If it is running, the handle waits for it to
+ * finish, so that the task never outlives the objects it uses, and its completion callback is not called.
+ * Plugins should therefore keep the handle in the object which the task works for.
+ */
+class task_handle_t
+{
+  public:
+    task_handle_t() = default;
+    ~task_handle_t();
+
+    task_handle_t(task_handle_t&& other) = default;
+    task_handle_t& operator =(task_handle_t&& other);
+    task_handle_t(const task_handle_t&) = delete;
+    task_handle_t& operator =(const task_handle_t&) = delete;
+
+    /**
+     * Cancel the task. Blocks while the task is running on a worker. No-op if the task has already
+     * completed or there is no task.
+     */
+    void cancel();
+
+    /**
+     * @return Whether the task was submitted and its completion callback has not been called yet.
+     */
+    bool is_pending() const;
+
+  private:
+    friend class thread_pool_t;
+    explicit task_handle_t(std::shared_ptr<detail::thread_pool_task_t> task);
+    std::shared_ptr<detail::thread_pool_task_t> task;
+};
+
+/**
+ * A pool of worker threads for CPU-heavy work which should not block the compositor thread, for example
+ * decoding images, rasterizing text or encoding screenshots.
+ *
+ * Each worker has its own queue, and idle workers steal tasks from the queues of busy workers. When a task
+ * is done, its completion callback is called on the thread of the Wayland event loop which the pool was
+ * created for, so the completion callback can safely use Wayfire's API. The work function itself runs on a
+ * worker and must not use Wayfire's API, wlroots or OpenGL.
+ *
+ * The pool of Wayfire itself is available as wf::get_core().thread_pool.
+ */
+class thread_pool_t
+{
+  public:
+    /**
+     * Create a new thread pool.
+     *
+     * @param loop The event loop on which completion callbacks are called.
+     * @param num_workers The number of worker threads. If it is not positive, one worker less than the
+     *   number of CPUs is used (but at least one).
+     */
+    thread_pool_t(wl_event_loop *loop, int num_workers);
+
+    /**
+     * Stops the workers. Tasks which have not started yet are cancelled, running tasks are waited for.
+     */
+    ~thread_pool_t();
+
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t& operator =(const thread_pool_t&) = delete;
+
+    /**
+     * Run @work on a worker thread, and afterwards @done on the event loop thread.
+     *
+     * @return The handle of the task. The task is cancelled when the handle is destroyed.
+     */
+    task_handle_t submit(std::function<void()> work, std::function<void()> done = {});
+
+    /**
+     * Run @work on a worker thread, and pass its result to @done on the event loop thread.
+     */
+    template<class Work, class Done,
+        class Result = std::invoke_result_t<Work>,
+        class = std::enable_if_t<!std::is_void_v<Result>>>
+    task_handle_t submit(Work work, Done done)
+    {
+        auto result = std::make_shared<std::optional<Result>>();
+        return submit(std::function<void()>{[result, work = std::move(work)] () mutable
+            {
+                result->emplace(work());
+            }
+        },
+            std::function<void()>{[result, done = std::move(done)] () mutable
+            {
+                done(std::move(**result));
+            }
+        });
+    }
+
+    /**
+     * @return The number of worker threads.
+     */
+    int get_num_workers() const;
+
+    class impl;
+
+  private:
+    std::unique_ptr<impl> priv;
+};
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <wayfire/debug.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace wf
+{
+/**
+ * Wayfire can record trace events (durations, asynchronous operations and counters) into an in-memory ring
+ * buffer, which can be written out in the Chrome trace-event JSON format and loaded in Perfetto or
+ * chrome://tracing. Each event is tagged with a logging category.
+ *
+ * Tracing is enabled with the --trace command line option or the wayfire/trace/enable IPC method. The buffer
+ * is written out with the wayfire/trace/flush IPC method or by sending SIGUSR1 to Wayfire. When the buffer is
+ * full, the oldest events are overwritten.
+ *
+ * Recording an event does not take any locks and does not allocate memory, as long as the event name is a
+ * string with static storage duration. Other names are interned, see @intern.
+ */
+namespace trace
+{
+/* Whether events are recorded. When tracing is disabled, the tracing macros only check this flag. */
+extern std::atomic<bool> enabled;
+
+/**
+ * Enable or disable tracing. The ring buffer is allocated the first time tracing is enabled.
+ */
+void set_enabled(bool enabled);
+
+/**
+ * Get a copy of @name which lives until Wayfire exits, for use as an event name.
+ */
+const char *intern(const std::string& name);
+
+/* Begin and end a duration event on the current thread. Duration events on one thread must be nested. */
+void begin(wf::log::logging_category category, const char *name);
+void end(wf::log::logging_category category, const char *name);
+
+/* Begin, end and mark a point in an asynchronous operation which is identified by @id, for example an
+ * object which may outlive the current function. */
+void async_begin(wf::log::logging_category category, const char *name, uint64_t id);
+void async_end(wf::log::logging_category category, const char *name, uint64_t id);
+void async_instant(wf::log::logging_category category, const char *name, uint64_t id);
+
+/* Record the current value of a counter. */
+void counter(wf::log::logging_category category, const char *name, int64_t value);
+
+/**
+ * Write the recorded events to the given file and remove them from the buffer.
+ *
+ * @return The number of events written, or -1 if the file could not be written.
+ */
+int64_t flush(const std::string& path);
+
+/**
+ * The file which SIGUSR1 flushes the trace to, by default wayfire-trace-<pid>.json in XDG_RUNTIME_DIR.
+ */
+std::string get_default_path();
+void set_default_path(const std::string& path);
+
+/**
+ * A duration event which lasts until the scope_t is destroyed.
+ */
+class scope_t
+{
+  public:
+    scope_t(wf::log::logging_category category, const char *name)
+    {
+        if (name && enabled.load(std::memory_order_relaxed))
+        {
+            this->category = category;
+            this->name     = name;
+            begin(category, name);
+        }
+    }
+
+    scope_t(wf::log::logging_category category, const std::string& name) :
+        scope_t(category, enabled.load(std::memory_order_relaxed) ? intern(name) : nullptr)
+    {}
+
+    ~scope_t()
+    {
+        if (name)
+        {
+            end(category, name);
+        }
+    }
+
+    scope_t(const scope_t&) = delete;
+    scope_t& operator =(const scope_t&) = delete;
+
+  private:
+    wf::log::logging_category category;
+    const char *name = nullptr;
+};
+}
+}
+
+#define WF_TRACE_CONCAT_IMPL(a, b) a ## b
+#define WF_TRACE_CONCAT(a, b) WF_TRACE_CONCAT_IMPL(a, b)
+
+/* Trace the rest of the current scope as a duration event. */
+#define TRACE_SCOPE(CAT, NAME) \
+    wf::trace::scope_t WF_TRACE_CONCAT(_wf_trace_scope_, __LINE__){wf::log::logging_category::CAT, NAME}
+
+#define TRACE_ASYNC_BEGIN(CAT, NAME, ID) \
+    do { \
+        if (wf::trace::enabled.load(std::memory_order_relaxed)) \
+        { \
+            wf::trace::async_begin(wf::log::logging_category::CAT, NAME, (uint64_t)(ID)); \
+        } \
+    } while (0)
+
+#define TRACE_ASYNC_END(CAT, NAME, ID) \
+    do { \
+        if (wf::trace::enabled.load(std::memory_order_relaxed)) \
+        { \
+            wf::trace::async_end(wf::log::logging_category::CAT, NAME, (uint64_t)(ID)); \
+        } \
+    } while (0)
+
+#define TRACE_ASYNC_INSTANT(CAT, NAME, ID) \
+    do { \
+        if (wf::trace::enabled.load(std::memory_order_relaxed)) \
+        { \
+            wf::trace::async_instant(wf::log::logging_category::CAT, NAME, (uint64_t)(ID)); \
+        } \
+    } while (0)
+
+#define TRACE_COUNTER(CAT, NAME, VALUE) \
+    do { \
+        if (wf::trace::enabled.load(std::memory_order_relaxed)) \
+        { \
+            wf::trace::counter(wf::log::logging_category::CAT, NAME, (int64_t)(VALUE)); \
+        } \
+    } while (0)
@@ -61,6 +61,8 @@ class translation_node_instance_t : public render_instance_t
     void presentation_feedback(wf::output_t *output) override;
     wf::scene::direct_scanout try_scanout(wf::output_t *output) override;
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override;
+    void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override;
+    std::string stringify() const override;
 };
 }
 }
@@ -134,6 +134,11 @@ class transformer_render_instance_t : public render_instance_t
         return self->get_updated_contents(self->get_children_bounding_box(), scale, children);
     }
 
+    std::string stringify() const override
+    {
+        return self->stringify();
+    }
+
     void presentation_feedback(wf::output_t *output) override
     {
         for (auto& ch : children)
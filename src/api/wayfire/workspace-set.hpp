@@ -39,7 +39,7 @@ enum wset_view_flags
     WSET_CURRENT_WORKSPACE = (1 << 2),
     // Sort the resulting array in the same order as the scenegraph nodes of the corresponding views.
     // Views not attached to the scenegraph (wf::get_core().scene()) are not included in the answer.
-    // This operation may be slow, so it should not be used on hot paths.
+    // The stacking order is cached until views are restacked, so repeated queries are cheap.
     WSET_SORT_STACKING     = (1 << 3),
 };
 
@@ -148,6 +148,20 @@ class workspace_set_t : public wf::signal::provider_t, public wf::object_base_t,
     std::vector<wayfire_toplevel_view> get_views(uint32_t flags = 0,
         std::optional<wf::point_t> workspace = {});
 
+    /**
+     * Get the views visible on a workspace of the grid without copying them.
+     *
+     * The workspace set keeps an index from workspaces to views which is updated when views move, so this
+     * is cheap even with many views on other workspaces. The list contains all views on the workspace,
+     * including unmapped and minimized ones, in the same order as get_views() without flags.
+     *
+     * The returned reference is invalidated by the next change to the views or the workspaces of the set, so
+     * it should not be kept around.
+     *
+     * @param workspace The workspace. For workspaces outside of the grid, the list is empty.
+     */
+    const std::vector<wayfire_toplevel_view>& get_views_on_workspace(wf::point_t workspace);
+
     /**
      * Get the main workspace for a view.
      * The main workspace is the one which contains the view's center.
@@ -5,9 +5,22 @@
 #include <wayfire/render.hpp>
 #include <wayfire/object.hpp>
 #include <wayfire/region.hpp>
+#include <wayfire/signal-provider.hpp>
 
 namespace wf
 {
+/**
+ * A bitmask of scene layers, where bit i stands for the layer with index i.
+ */
+using layer_mask_t = uint32_t;
+
+constexpr layer_mask_t layer_to_mask(scene::layer layer)
+{
+    return 1u << (uint32_t)layer;
+}
+
+constexpr layer_mask_t ALL_LAYERS_MASK = (1u << (uint32_t)scene::layer::ALL_LAYERS) - 1;
+
 /**
  * A workspace stream is a special node which displays a workspace of an output.
  */
@@ -21,6 +34,9 @@ class workspace_stream_node_t : public scene::node_t
     // of Wayfire is used.
     std::optional<wf::color_t> background;
 
+    // The layers of the output which are displayed.
+    layer_mask_t layers = ALL_LAYERS_MASK;
+
     wf::output_t*const output;
     const wf::point_t ws;
 
@@ -37,4 +53,92 @@ class workspace_stream_node_t : public scene::node_t
 
   private:
 };
+
+class workspace_texture_t;
+
+/**
+ * on: workspace_texture_t
+ * when: Emitted when a part of the workspace shown in the texture is damaged.
+ */
+struct workspace_texture_damage_signal
+{
+    workspace_texture_t *texture;
+    // The damaged region, relative to the workspace (i.e. in the coordinate system of the workspace stream).
+    wf::region_t region;
+};
+
+/**
+ * A workspace of an output rendered to an offscreen texture.
+ *
+ * Textures are shared: all plugins which request the same workspace with the same layers and scale get the
+ * same texture. Damage is collected once for all of them, and the damaged parts are rendered only once, by
+ * the first consumer which updates the texture, for example when the cube is opened on top of expo.
+ */
+class workspace_texture_t : public wf::signal::provider_t
+{
+  public:
+    /**
+     * Get the texture for the given workspace, creating it if no other plugin uses it at the moment.
+     * A new texture is fully damaged. The texture is freed when the last reference to it is dropped.
+     *
+     * @param output The output whose workspace is rendered.
+     * @param workspace The workspace to render.
+     * @param layers The layers to render, other layers are skipped.
+     * @param scale The scale of the texture relative to the logical size of the output. Plugins which show
+     *   the workspace scaled down can use a smaller scale than the output's scale.
+     */
+    static std::shared_ptr<workspace_texture_t> get(wf::output_t *output, wf::point_t workspace,
+        layer_mask_t layers = ALL_LAYERS_MASK, float scale = 1.0);
+
+    ~workspace_texture_t();
+
+    /**
+     * Render the damaged parts of the texture which are inside @region. Damage outside of @region is kept
+     * for later updates. Should be called during the render pass of the output, usually from
+     * schedule_instructions(), before using the texture.
+     *
+     * @param region The region of the workspace which will be used, relative to the workspace.
+     */
+    void update(const wf::region_t& region);
+
+    /**
+     * Render all damaged parts of the texture.
+     */
+    void update();
+
+    /**
+     * @return The texture with the contents of the workspace. Valid until the next update().
+     */
+    wf::texture_t get_texture();
+
+    /**
+     * @return The damage which has not been rendered yet, relative to the workspace.
+     */
+    const wf::region_t& get_pending_damage() const;
+
+    /**
+     * Compute the visibility of the surfaces on the workspace.
+     *
+     * @param visible The region of the workspace which is visible, relative to the workspace.
+     */
+    void compute_visibility(wf::region_t& visible);
+
+    /**
+     * Forward presentation feedback to the surfaces on the workspace.
+     */
+    void presentation_feedback();
+
+    wf::output_t *get_output() const;
+    wf::point_t get_workspace() const;
+    layer_mask_t get_layers() const;
+    float get_scale() const;
+
+    workspace_texture_t(const workspace_texture_t&) = delete;
+    workspace_texture_t& operator =(const workspace_texture_t&) = delete;
+
+  private:
+    workspace_texture_t(wf::output_t *output, wf::point_t workspace, layer_mask_t layers, float scale);
+    struct impl;
+    std::unique_ptr<impl> priv;
+};
 }
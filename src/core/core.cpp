@@ -43,6 +43,7 @@
 #include "../view/view-impl.hpp"
 #include "main.hpp"
 #include <wayfire/window-manager.hpp>
+#include <wayfire/thread-pool.hpp>
 
 #include "core-impl.hpp"
 
@@ -101,6 +102,8 @@ void wf::compositor_core_impl_t::init()
     this->scene_root = std::make_shared<scene::root_node_t>();
     this->tx_manager = std::make_unique<txn::transaction_manager_t>();
     this->default_wm = std::make_unique<wf::window_manager_t>();
+    this->thread_pool = std::make_unique<wf::thread_pool_t>(ev_loop,
+        wf::option_wrapper_t<int>{"core/worker_threads"});
 
     wlr_renderer_init_wl_display(renderer, display);
 
@@ -348,6 +351,8 @@ void wf::compositor_core_impl_t::fini()
     LOGI("Unloading plugins...");
     plugin_mgr.reset();
     _clear_data();
+    // Plugins cancel their tasks when they are unloaded, so nothing is left running on the workers.
+    thread_pool.reset();
 
     // Shut down xwayland first, otherwise, wlroots will attempt to restart it when we kill it via
     // wl_display_destroy_clients().
@@ -4,8 +4,13 @@
 #include <wayfire/view.hpp>
 #include <wayfire/output.hpp>
 #include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "scene-priv.hpp"
+#include "../output/output-impl.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/output-layout.hpp"
 #include "wayfire/region.hpp"
@@ -236,9 +241,34 @@ class default_render_instance_t : public render_instance_t
     }
 };
 
+/**
+ * The range of instances which a node generated in a flat list of instances.
+ */
+struct instance_range_t
+{
+    node_ptr node;
+    size_t first;
+    size_t count;
+};
+
+/**
+ * Records the ranges which nodes generate with the default gen_render_instances() in a flat list of
+ * instances. Their instances are fully determined by the node and its enabled children, so the instances of
+ * such a subtree can be regenerated without touching the rest of the list.
+ */
+struct instance_range_recorder_t
+{
+    const std::vector<render_instance_uptr> *instances;
+    std::vector<instance_range_t> ranges;
+};
+
+static instance_range_recorder_t *current_range_recorder = nullptr;
+
 void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
     damage_callback push_damage, wf::output_t *output)
 {
+    const size_t first = instances.size();
+
     // Add self for damage tracking
     instances.push_back(
         std::make_unique<default_render_instance_t>(this, push_damage));
@@ -251,6 +281,11 @@ void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
             ch->gen_render_instances(instances, push_damage, output);
         }
     }
+
+    if (current_range_recorder && (current_range_recorder->instances == &instances))
+    {
+        current_range_recorder->ranges.push_back({shared_from_this(), first, instances.size() - first});
+    }
 }
 
 wf::geometry_t node_t::get_children_bounding_box()
@@ -373,27 +408,323 @@ std::optional<input_node_t> output_node_t::find_node_at(const wf::pointf_t& at)
 class output_render_instance_t : public default_render_instance_t
 {
     wf::output_t *output;
+    wf::output_t *shown_on;
     output_node_t *self;
+    damage_callback push_damage_children;
+
+    // Children are stored as a sublist, because we need to translate every
+    // time between global and output-local geometry.
     std::vector<render_instance_uptr> children;
 
+    // The ranges of the nodes with the default instance generation in the
+    // children list, sorted by their first instance. The own instance of such
+    // a node comes before the instances of its children, so a node is always
+    // followed by the ranges of its subtree.
+    std::vector<instance_range_t> ranges;
+
+    // The first node with a range whose subtree changed since the last
+    // regeneration, and whether the change could not be attributed to a
+    // single subtree.
+    node_ptr dirty_node = nullptr;
+    bool dirty_all = false;
+
+    wf::signal::connection_t<node_update_signal> on_child_update = [=] (node_update_signal *ev)
+    {
+        if ((ev->flags & update_flag::MASKED) && ev->node->is_enabled())
+        {
+            // A disabled node in the child's subtree changed, nothing to regenerate.
+            return;
+        }
+
+        if (!(ev->flags & (update_flag::CHILDREN_LIST | update_flag::ENABLED)))
+        {
+            return;
+        }
+
+        // The update is reported on every node on its way to the output, the
+        // deepest one is the changed subtree.
+        if (!dirty_node)
+        {
+            dirty_node = ev->node->shared_from_this();
+        } else if (!is_ancestor(ev->node, dirty_node.get()))
+        {
+            dirty_all = true;
+        }
+    };
+
+    wf::signal::connection_t<node_regen_instances_signal> on_regen_instances = [=] (auto)
+    {
+        regen_children();
+    };
+
   public:
     output_render_instance_t(output_node_t *self, damage_callback callback,
         wf::output_t *output, wf::output_t *shown_on) :
         default_render_instance_t(self, transform_damage(callback))
     {
-        this->self   = self;
-        this->output = output;
+        this->self     = self;
+        this->output   = output;
+        this->shown_on = shown_on;
+        this->push_damage_children = transform_damage(callback);
+
+        dirty_all = true;
+        regen_children();
+        self->connect(&on_regen_instances);
+    }
+
+    static bool is_ancestor(node_t *ancestor, node_t *node)
+    {
+        for (; node; node = node->parent())
+        {
+            if (node == ancestor)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Generate the instances of @node at the end of @instances, and add the
+     * ranges of the nodes in its subtree to @new_ranges.
+     */
+    void gen_recorded(const node_ptr& node, std::vector<render_instance_uptr>& instances,
+        std::vector<instance_range_t>& new_ranges)
+    {
+        instance_range_recorder_t recorder{&instances, {}};
+        auto previous = std::exchange(current_range_recorder, &recorder);
+        node->gen_render_instances(instances, push_damage_children, shown_on);
+        current_range_recorder = previous;
+
+        // Nodes with custom instance generation may generate their children
+        // into the same list, but with a different damage callback. Only keep
+        // the ranges which are reached from @node through recorded nodes.
+        std::unordered_set<node_t*> recorded;
+        for (auto& range : recorder.ranges)
+        {
+            recorded.insert(range.node.get());
+        }
+
+        for (auto& range : recorder.ranges)
+        {
+            node_t *it = range.node.get();
+            while ((it != node.get()) && recorded.count(it))
+            {
+                it = it->parent();
+            }
+
+            if (it == node.get())
+            {
+                new_ranges.push_back(std::move(range));
+            }
+        }
+    }
+
+    /**
+     * Regenerate the instances of the subtree which changed since the last
+     * regeneration. Instances of other nodes are reused.
+     */
+    void regen_children()
+    {
+        const int64_t start = wf::get_current_time_us();
+
+        const node_ptr dirty = std::exchange(dirty_node, nullptr);
+        const bool all = std::exchange(dirty_all, false);
+        node_t *changed    = dirty.get();
+
+        // A node which was disabled is regenerated as a part of its parent.
+        auto find_range = [&] (node_t *node)
+        {
+            return std::find_if(ranges.begin(), ranges.end(), [&] (const instance_range_t& range)
+            {
+                return range.node.get() == node;
+            });
+        };
+
+        auto range = ranges.end();
+        while (!all && changed && (changed != self))
+        {
+            range = find_range(changed);
+            if (changed->is_enabled() && (range != ranges.end()))
+            {
+                break;
+            }
+
+            range   = ranges.end();
+            changed = changed->parent();
+        }
+
+        int regenerated;
+        if (range != ranges.end())
+        {
+            regenerated = regen_subtree(range - ranges.begin());
+        } else
+        {
+            regenerated = regen_all(!all);
+        }
+
+        on_child_update.disconnect();
+        for (auto& r : ranges)
+        {
+            r.node->connect(&on_child_update);
+        }
+
+        const int64_t duration = wf::get_current_time_us() - start;
+        if (output->render)
+        {
+            priv_render_manager_report_instance_regen(output->render.get(), regenerated, duration);
+        }
+
+        LOGC(RENDER, "Output ", output->to_string(), ": regenerated instances for ", regenerated,
+            " nodes in ", duration, "us.");
+    }
 
-        // Children are stored as a sublist, because we need to translate every
-        // time between global and output-local geometry.
+    /**
+     * Regenerate the instances of all children of the output node.
+     *
+     * @param reuse Whether the instances of children with a range can be
+     *   reused. Otherwise, everything is regenerated.
+     * @return The number of nodes whose instances were generated.
+     */
+    int regen_all(bool reuse)
+    {
+        // Keep the old nodes alive until their instances are destroyed.
+        auto old_ranges    = std::move(ranges);
+        auto old_instances = std::move(children);
+        ranges.clear();
+        children.clear();
+
+        int regenerated = 0;
         for (auto& child : self->get_children())
         {
             if (child->is_enabled())
             {
-                child->gen_render_instances(children,
-                    transform_damage(callback), shown_on);
+                regenerated += reuse_or_gen(child, old_ranges, old_instances, children, ranges, 0,
+                    reuse);
+            }
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [] (const instance_range_t& a, const instance_range_t& b)
+        {
+            return a.first < b.first;
+        });
+
+        return regenerated;
+    }
+
+    /**
+     * Regenerate the instances of the node with the range at @idx. The
+     * instances of its enabled children which have a range are reused.
+     *
+     * @return The number of nodes whose instances were generated.
+     */
+    int regen_subtree(size_t idx)
+    {
+        const auto node  = ranges[idx].node;
+        const size_t first = ranges[idx].first;
+        const size_t last  = first + ranges[idx].count;
+        size_t idx_end = idx + 1;
+        while ((idx_end < ranges.size()) && (ranges[idx_end].first < last))
+        {
+            ++idx_end;
+        }
+
+        // Keep the old nodes alive until their instances are destroyed.
+        std::vector<instance_range_t> old_ranges{
+            std::make_move_iterator(ranges.begin() + idx),
+            std::make_move_iterator(ranges.begin() + idx_end)
+        };
+        std::vector<render_instance_uptr> old_instances{
+            std::make_move_iterator(children.begin() + first),
+            std::make_move_iterator(children.begin() + last)
+        };
+
+        // The node's own instance is the first one, see node_t::gen_render_instances().
+        std::vector<render_instance_uptr> instances;
+        std::vector<instance_range_t> new_ranges;
+        instances.push_back(std::move(old_instances[0]));
+        int regenerated = 0;
+        for (auto& child : node->get_children())
+        {
+            if (child->is_enabled())
+            {
+                regenerated += reuse_or_gen(child, old_ranges, old_instances, instances, new_ranges,
+                    first, true);
+            }
+        }
+
+        new_ranges.push_back({node, 0, instances.size()});
+        for (auto& r : new_ranges)
+        {
+            r.first += first;
+        }
+
+        std::sort(new_ranges.begin(), new_ranges.end(),
+            [] (const instance_range_t& a, const instance_range_t& b)
+        {
+            return a.first < b.first;
+        });
+
+        // Update the ranges of the ancestors and of the nodes after the subtree.
+        const int64_t delta = (int64_t)instances.size() - (int64_t)(last - first);
+        for (size_t i = 0; i < idx; i++)
+        {
+            if (ranges[i].first + ranges[i].count >= last)
+            {
+                ranges[i].count += delta;
             }
         }
+
+        for (size_t i = idx_end; i < ranges.size(); i++)
+        {
+            ranges[i].first += delta;
+        }
+
+        ranges.erase(ranges.begin() + idx, ranges.begin() + idx_end);
+        ranges.insert(ranges.begin() + idx, std::make_move_iterator(new_ranges.begin()),
+            std::make_move_iterator(new_ranges.end()));
+
+        children.erase(children.begin() + first, children.begin() + last);
+        children.insert(children.begin() + first, std::make_move_iterator(instances.begin()),
+            std::make_move_iterator(instances.end()));
+        return regenerated;
+    }
+
+    /**
+     * Append the instances of @child to @instances. If it has a range in
+     * @old_ranges, its old instances and ranges are moved over, otherwise they
+     * are generated.
+     *
+     * @param base The position of @old_instances in the children list.
+     * @return 1 if the instances were generated, 0 if they were reused.
+     */
+    int reuse_or_gen(const node_ptr& child, std::vector<instance_range_t>& old_ranges,
+        std::vector<render_instance_uptr>& old_instances, std::vector<render_instance_uptr>& instances,
+        std::vector<instance_range_t>& new_ranges, size_t base, bool reuse)
+    {
+        auto it = std::find_if(old_ranges.begin(), old_ranges.end(), [&] (const instance_range_t& range)
+        {
+            return range.node == child;
+        });
+
+        if (!reuse || (it == old_ranges.end()))
+        {
+            gen_recorded(child, instances, new_ranges);
+            return 1;
+        }
+
+        // The ranges of the child's subtree follow its own range.
+        const size_t first = it->first - base;
+        const size_t last  = first + it->count;
+        const size_t moved_to = instances.size();
+        for (; (it != old_ranges.end()) && (it->first - base < last); ++it)
+        {
+            new_ranges.push_back({it->node, it->first - base - first + moved_to, it->count});
+        }
+
+        std::move(old_instances.begin() + first, old_instances.begin() + last, std::back_inserter(instances));
+        return 0;
     }
 
     damage_callback transform_damage(damage_callback child_damage)
@@ -469,6 +800,22 @@ class output_render_instance_t : public default_render_instance_t
         auto offset = wf::origin(output->get_layout_geometry());
         compute_visibility_from_list(children, output, visible, offset);
     }
+
+    void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        auto offset = wf::origin(output->get_layout_geometry());
+        if (self->limit_region)
+        {
+            // Instances outside of the limit region are not rendered, see schedule_instructions().
+            wf::region_t our_damage = damage & *self->limit_region;
+            our_damage &= target.geometry;
+            expand_damage_from_list(children, target, our_damage, offset);
+            damage |= our_damage & *self->limit_region;
+        } else
+        {
+            expand_damage_from_list(children, target, damage, offset);
+        }
+    }
 };
 
 void output_node_t::gen_render_instances(
@@ -494,6 +841,11 @@ wf::geometry_t output_node_t::get_bounding_box()
     return bbox + wf::origin(priv->output->get_layout_geometry());
 }
 
+uint32_t output_node_t::optimize_update(uint32_t flags)
+{
+    return optimize_nested_render_instances(shared_from_this(), floating_inner_node_t::optimize_update(flags));
+}
+
 wf::output_t*output_node_t::get_output() const
 {
     return priv->output;
@@ -540,7 +892,12 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled)
     }
 }
 
-void update(node_ptr changed_node, uint32_t flags)
+/**
+ * Propagate an update to the root. @root_flags accumulates the children list and
+ * enabled changes of the update sequence, including those which nested nodes
+ * (outputs, transformers) have handled locally and stripped from @flags.
+ */
+static void update_impl(node_ptr changed_node, uint32_t flags, uint32_t root_flags)
 {
     if ((flags & update_flag::CHILDREN_LIST) ||
         (flags & update_flag::ENABLED) ||
@@ -555,6 +912,8 @@ void update(node_ptr changed_node, uint32_t flags)
         flags |= update_flag::MASKED;
     }
 
+    root_flags |= flags & (update_flag::CHILDREN_LIST | update_flag::ENABLED);
+
     node_update_signal data;
     data.node  = changed_node.get();
     data.flags = flags;
@@ -563,7 +922,7 @@ void update(node_ptr changed_node, uint32_t flags)
     if (changed_node == wf::get_core().scene())
     {
         root_node_update_signal data;
-        data.flags = flags;
+        data.flags = flags | root_flags;
         wf::get_core().scene()->emit(&data);
         return;
     }
@@ -576,10 +935,15 @@ void update(node_ptr changed_node, uint32_t flags)
             flags |= update_flag::MASKED;
         }
 
-        update(changed_node->parent()->shared_from_this(), flags);
+        update_impl(changed_node->parent()->shared_from_this(), flags, root_flags);
     }
 }
 
+void update(node_ptr changed_node, uint32_t flags)
+{
+    update_impl(changed_node, flags, 0);
+}
+
 floating_inner_node_t::~floating_inner_node_t()
 {
     for (auto& node : this->children)
@@ -631,9 +995,33 @@ render_instance_manager_t::render_instance_manager_t(std::vector<node_ptr> nodes
 
         if (ev->flags & recompute_instances_on)
         {
-            LOGC(RENDER, this, ": Output ", output_name(), ": regenerating instances from ", nodes.size(),
-                " nodes (root=", is_root() ? "true" : "false", ").");
-            regen_instances();
+            const int64_t start = wf::get_current_time_us();
+            auto it = std::find_if(nodes.begin(), nodes.end(), [&] (const node_ptr& node)
+            {
+                return node.get() == ev->node;
+            });
+
+            // Only the instances of the node which was updated need to be regenerated, the instances of
+            // the other nodes can be reused.
+            size_t regenerated = nodes.size();
+            if ((nodes.size() > 1) && (it != nodes.end()))
+            {
+                regen_node_instances(it - nodes.begin());
+                regenerated = 1;
+                ++partial_regens;
+            } else
+            {
+                regen_instances();
+                ++full_regens;
+            }
+
+            const int64_t duration = wf::get_current_time_us() - start;
+            total_regen_time_us += duration;
+            LOGC(RENDER, this, ": Output ", output_name(), ": regenerated instances from ",
+                regenerated, "/", nodes.size(),
+                " nodes (root=", is_root() ? "true" : "false", ") in ", duration, "us. ",
+                "Total regenerations: ", full_regens, " full, ", partial_regens, " partial, ",
+                total_regen_time_us, "us.");
         }
 
         if (ev->flags & recompute_visibility_on)
@@ -656,12 +1044,33 @@ render_instance_manager_t::render_instance_manager_t(std::vector<node_ptr> nodes
 void render_instance_manager_t::regen_instances()
 {
     instances.clear();
+    instance_counts.clear();
     for (auto& node : nodes)
     {
+        const size_t first = instances.size();
         node->gen_render_instances(instances, on_damage, reference_output);
+        instance_counts.push_back(instances.size() - first);
     }
 }
 
+void render_instance_manager_t::regen_node_instances(size_t idx)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < idx; i++)
+    {
+        offset += instance_counts[i];
+    }
+
+    auto first = instances.begin() + offset;
+    instances.erase(first, first + instance_counts[idx]);
+
+    std::vector<render_instance_uptr> node_instances;
+    nodes[idx]->gen_render_instances(node_instances, on_damage, reference_output);
+    instances.insert(instances.begin() + offset,
+        std::make_move_iterator(node_instances.begin()), std::make_move_iterator(node_instances.end()));
+    instance_counts[idx] = node_instances.size();
+}
+
 void render_instance_manager_t::set_visibility_region(wf::region_t region)
 {
     this->visibility_region = region;
@@ -7,6 +7,7 @@
 #include "wayfire/output-layout.hpp"
 #include "tablet.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include "wayfire/trace.hpp"
 
 wf::cursor_t::cursor_t(wf::seat_t *seat)
 {
@@ -46,6 +47,7 @@ void wf::cursor_t::setup_listeners()
     /* Dispatch pointer events to the pointer_t */
     on_frame.set_callback([&] (void*)
     {
+        TRACE_SCOPE(POINTER, "pointer-frame");
         seat->priv->lpointer->handle_pointer_frame();
         wf::get_core().seat->notify_activity();
     });
@@ -53,6 +55,7 @@ void wf::cursor_t::setup_listeners()
 
 #define setup_passthrough_callback(evname) \
     on_ ## evname.set_callback([&] (void *data) { \
+        TRACE_SCOPE(POINTER, "pointer-" #evname); \
         set_touchscreen_mode(false); \
         auto ev   = static_cast<wlr_pointer_ ## evname ## _event*>(data); \
         auto mode = emit_device_event_signal(ev, &ev->pointer->base); \
@@ -85,6 +88,7 @@ void wf::cursor_t::setup_listeners()
      */
 #define setup_tablet_callback(evname) \
     on_tablet_ ## evname.set_callback([&] (void *data) { \
+        TRACE_SCOPE(INPUT_DEVICES, "tablet-" #evname); \
         set_touchscreen_mode(false); \
         auto ev = static_cast<wlr_tablet_tool_ ## evname ## _event*>(data); \
         auto handling_mode = emit_device_event_signal(ev, &ev->tablet->base); \
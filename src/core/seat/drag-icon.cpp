@@ -88,6 +88,14 @@ class dnd_root_icon_root_node_t : public floating_inner_node_t
                 compute_visibility_from_list(children, output, visible, self->get_position());
             }
         }
+
+        void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            if (auto self = _self.lock())
+            {
+                expand_damage_from_list(children, target, damage, self->get_position());
+            }
+        }
     };
 
   public:
@@ -12,6 +12,7 @@
 #include "input-manager.hpp"
 #include "input-method-relay.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include "wayfire/trace.hpp"
 #include <wayfire/config-backend.hpp>
 
 void wf::keyboard_t::setup_listeners()
@@ -24,6 +25,7 @@ void wf::keyboard_t::setup_listeners()
 
     on_key.set_callback([&] (void *data)
     {
+        TRACE_SCOPE(KBD, "keyboard-key");
         auto ev    = static_cast<wlr_keyboard_key_event*>(data);
         auto mode  = emit_device_event_signal(ev, &handle->base);
         auto& seat = wf::get_core_impl().seat;
@@ -9,6 +9,7 @@
 #include "wayfire/output.hpp"
 #include "wayfire/util.hpp"
 #include "wayfire/output-layout.hpp"
+#include "wayfire/trace.hpp"
 #include <glm/glm.hpp>
 
 class touch_timer_adapter_t : public wf::touch::timer_interface_t
@@ -36,6 +37,7 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
     // connect handlers
     on_down.set_callback([=] (void *data)
     {
+        TRACE_SCOPE(INPUT_DEVICES, "touch-down");
         auto ev   = static_cast<wlr_touch_down_event*>(data);
         auto mode = emit_device_event_signal(ev, &ev->touch->base);
         if (mode != input_event_processing_mode_t::IGNORE)
@@ -54,6 +56,7 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
 
     on_up.set_callback([=] (void *data)
     {
+        TRACE_SCOPE(INPUT_DEVICES, "touch-up");
         auto ev   = static_cast<wlr_touch_up_event*>(data);
         auto mode = emit_device_event_signal(ev, &ev->touch->base);
         if (mode != input_event_processing_mode_t::IGNORE)
@@ -67,6 +70,7 @@ wf::touch_interface_t::touch_interface_t(wlr_cursor *cursor, wlr_seat *seat,
 
     on_motion.set_callback([=] (void *data)
     {
+        TRACE_SCOPE(INPUT_DEVICES, "touch-motion");
         auto ev   = static_cast<wlr_touch_motion_event*>(data);
         auto mode = emit_device_event_signal(ev, &ev->touch->base);
 
@@ -0,0 +1,334 @@
+#include <wayfire/thread-pool.hpp>
+#include <wayfire/debug.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+struct wf::detail::thread_pool_task_t
+{
+    enum state_t
+    {
+        QUEUED,
+        RUNNING,
+        FINISHED,
+        COMPLETED,
+    };
+
+    std::function<void()> work;
+    std::function<void()> done;
+
+    std::mutex mutex;
+    std::condition_variable state_changed;
+    state_t state  = QUEUED;
+    bool cancelled = false;
+};
+
+using task_ptr = std::shared_ptr<wf::detail::thread_pool_task_t>;
+using task_t   = wf::detail::thread_pool_task_t;
+
+class wf::thread_pool_t::impl
+{
+  public:
+    impl(wl_event_loop *loop, int num_workers)
+    {
+        if (num_workers <= 0)
+        {
+            num_workers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        }
+
+        completion_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        completion_source = wl_event_loop_add_fd(loop, completion_fd, WL_EVENT_READABLE,
+            [] (int fd, uint32_t mask, void *data)
+        {
+            static_cast<impl*>(data)->deliver_completions();
+            return 0;
+        }, this);
+
+        queues = std::vector<worker_queue_t>(num_workers);
+        for (int i = 0; i < num_workers; i++)
+        {
+            workers.emplace_back([this, i] () { run_worker(i); });
+        }
+
+        LOGD("Started thread pool with ", num_workers, " workers");
+    }
+
+    ~impl()
+    {
+        {
+            std::lock_guard lock{sleep_mutex};
+            stopping = true;
+        }
+
+        // Cancel the tasks which have not started yet before waking up the workers, so that they do not
+        // pick up any more work.
+        for (auto& queue : queues)
+        {
+            std::lock_guard lock{queue.mutex};
+            for (auto& task : queue.tasks)
+            {
+                cancel_task(task);
+            }
+
+            queued -= (int)queue.tasks.size();
+            queue.tasks.clear();
+        }
+
+        wakeup.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        // Completions of finished tasks can no longer be delivered.
+        for (auto& task : completed)
+        {
+            cancel_task(task);
+        }
+
+        completed.clear();
+        wl_event_source_remove(completion_source);
+        close(completion_fd);
+    }
+
+    void submit(task_ptr task)
+    {
+        auto& queue = queues[next_queue++ % queues.size()];
+        {
+            std::lock_guard lock{queue.mutex};
+            queue.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard lock{sleep_mutex};
+            ++queued;
+        }
+
+        wakeup.notify_one();
+    }
+
+    int get_num_workers() const
+    {
+        return workers.size();
+    }
+
+  private:
+    struct worker_queue_t
+    {
+        std::mutex mutex;
+        std::deque<task_ptr> tasks;
+    };
+
+    std::vector<worker_queue_t> queues;
+    std::vector<std::thread> workers;
+    size_t next_queue = 0;
+
+    // Workers sleep while there are no queued tasks.
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+
+    // Finished tasks whose completion has not been delivered yet.
+    std::mutex completed_mutex;
+    std::vector<task_ptr> completed;
+    int completion_fd;
+    wl_event_source *completion_source;
+
+    static void cancel_task(const task_ptr& task)
+    {
+        std::lock_guard lock{task->mutex};
+        task->cancelled = true;
+    }
+
+    /**
+     * Take a task from the front of the worker's own queue, or steal one from the back of another queue.
+     */
+    task_ptr take_task(size_t worker)
+    {
+        for (size_t i = 0; i < queues.size(); i++)
+        {
+            auto& queue = queues[(worker + i) % queues.size()];
+            std::lock_guard lock{queue.mutex};
+            if (!queue.tasks.empty())
+            {
+                task_ptr task;
+                if (i == 0)
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                } else
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+
+                --queued;
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void run_worker(size_t index)
+    {
+        while (!stopping)
+        {
+            auto task = take_task(index);
+            if (!task)
+            {
+                std::unique_lock lock{sleep_mutex};
+                wakeup.wait(lock, [&] { return stopping || (queued > 0); });
+                if (stopping)
+                {
+                    return;
+                }
+
+                continue;
+            }
+
+            {
+                std::lock_guard lock{task->mutex};
+                if (task->cancelled)
+                {
+                    continue;
+                }
+
+                task->state = task_t::RUNNING;
+            }
+
+            task->work();
+
+            bool deliver;
+            {
+                std::lock_guard lock{task->mutex};
+                task->state = task_t::FINISHED;
+                deliver = !task->cancelled;
+            }
+
+            task->state_changed.notify_all();
+            if (deliver)
+            {
+                std::lock_guard lock{completed_mutex};
+                completed.push_back(std::move(task));
+                // Writing can only fail if the counter would overflow, but then the fd is readable anyway.
+                const uint64_t one = 1;
+                (void)!write(completion_fd, &one, sizeof(one));
+            }
+        }
+    }
+
+    void deliver_completions()
+    {
+        uint64_t count;
+        while (read(completion_fd, &count, sizeof(count)) == sizeof(count))
+        {}
+
+        std::vector<task_ptr> batch;
+        {
+            std::lock_guard lock{completed_mutex};
+            std::swap(batch, completed);
+        }
+
+        for (auto& task : batch)
+        {
+            std::function<void()> done;
+            {
+                std::lock_guard lock{task->mutex};
+                if (task->cancelled)
+                {
+                    continue;
+                }
+
+                task->state = task_t::COMPLETED;
+                done = std::move(task->done);
+                task->work = {};
+            }
+
+            if (done)
+            {
+                done();
+            }
+        }
+    }
+};
+
+wf::thread_pool_t::thread_pool_t(wl_event_loop *loop, int num_workers)
+{
+    priv = std::make_unique<impl>(loop, num_workers);
+}
+
+wf::thread_pool_t::~thread_pool_t() = default;
+
+wf::task_handle_t wf::thread_pool_t::submit(std::function<void()> work, std::function<void()> done)
+{
+    auto task = std::make_shared<task_t>();
+    task->work = std::move(work);
+    task->done = std::move(done);
+    priv->submit(task);
+    return task_handle_t{task};
+}
+
+int wf::thread_pool_t::get_num_workers() const
+{
+    return priv->get_num_workers();
+}
+
+wf::task_handle_t::task_handle_t(std::shared_ptr<detail::thread_pool_task_t> task) : task(std::move(task))
+{}
+
+wf::task_handle_t::~task_handle_t()
+{
+    cancel();
+}
+
+wf::task_handle_t& wf::task_handle_t::operator =(task_handle_t&& other)
+{
+    if (this != &other)
+    {
+        cancel();
+        task = std::move(other.task);
+    }
+
+    return *this;
+}
+
+void wf::task_handle_t::cancel()
+{
+    if (!task)
+    {
+        return;
+    }
+
+    std::function<void()> work, done;
+    {
+        std::unique_lock lock{task->mutex};
+        if (task->state != task_t::COMPLETED)
+        {
+            task->cancelled = true;
+            task->state_changed.wait(lock, [&] { return task->state != task_t::RUNNING; });
+            // Free the resources held by the callbacks here rather than on a worker.
+            work = std::move(task->work);
+            done = std::move(task->done);
+        }
+    }
+
+    task.reset();
+}
+
+bool wf::task_handle_t::is_pending() const
+{
+    if (!task)
+    {
+        return false;
+    }
+
+    std::lock_guard lock{task->mutex};
+    return (task->state != task_t::COMPLETED) && !task->cancelled;
+}
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <wayfire/txn/transaction-manager.hpp>
 #include <wayfire/debug.hpp>
+#include <wayfire/trace.hpp>
 
 static bool transactions_intersect(const wf::txn::transaction_uptr& a, const wf::txn::transaction_uptr& b)
 {
@@ -25,6 +26,8 @@ struct wf::txn::transaction_manager_t::impl
     void schedule_transaction(transaction_uptr tx)
     {
         LOGC(TXN, "Scheduling transaction ", tx.get());
+        TRACE_SCOPE(TXN, "schedule-transaction");
+        TRACE_ASYNC_BEGIN(TXN, "transaction", tx.get());
 
         // Step 1: add any objects which are directly or indirectly connected to the objects in tx
         coalesce_transactions(tx);
@@ -35,6 +38,13 @@ struct wf::txn::transaction_manager_t::impl
         // Step 3: schedule tx for execution. At this point, there are no conflicts in all pending txs
         pending.push_back(std::move(tx));
         consider_commit();
+        trace_counts();
+    }
+
+    void trace_counts()
+    {
+        TRACE_COUNTER(TXN, "pending-transactions", pending.size());
+        TRACE_COUNTER(TXN, "committed-transactions", committed.size());
     }
 
     void coalesce_transactions(const transaction_uptr& tx)
@@ -65,7 +75,14 @@ struct wf::txn::transaction_manager_t::impl
     {
         auto it = std::remove_if(pending.begin(), pending.end(), [&] (const transaction_uptr& existing)
         {
-            return transactions_intersect(existing, tx);
+            if (transactions_intersect(existing, tx))
+            {
+                // The objects of the existing transaction are now part of tx.
+                TRACE_ASYNC_END(TXN, "transaction", existing.get());
+                return true;
+            }
+
+            return false;
         });
         pending.erase(it, pending.end());
     }
@@ -125,8 +142,10 @@ struct wf::txn::transaction_manager_t::impl
 
         wf::dassert(it != committed.end(), "Transaction not found in committed list");
 
+        TRACE_ASYNC_END(TXN, "transaction", ev->self);
         done.push_back(std::move(*it));
         committed.erase(it);
         consider_commit();
+        trace_counts();
     };
 };
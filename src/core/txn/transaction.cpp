@@ -3,6 +3,7 @@
 #include <wayfire/txn/transaction.hpp>
 #include <sstream>
 #include <wayfire/debug.hpp>
+#include <wayfire/trace.hpp>
 
 std::string wf::txn::transaction_object_t::stringify() const
 {
@@ -19,6 +20,7 @@ wf::txn::transaction_t::transaction_t(uint64_t timeout, timer_setter_t timer_set
     this->on_object_ready = [=] (object_ready_signal *ev)
     {
         this->count_ready_objects++;
+        TRACE_ASYNC_INSTANT(TXNI, "object-ready", this);
         LOGC(TXNI, "Transaction ", this, " object ", ev->self->stringify(), " became ready (",
             count_ready_objects, "/", this->objects.size(), ")");
 
@@ -48,6 +50,8 @@ void wf::txn::transaction_t::add_object(transaction_object_sptr object)
 void wf::txn::transaction_t::commit()
 {
     LOGC(TXN, "Committing transaction ", this, " with timeout ", this->timeout);
+    TRACE_SCOPE(TXN, "commit-transaction");
+    TRACE_ASYNC_INSTANT(TXN, "committed", this);
     if (this->objects.empty())
     {
         // Empty transaction, directly ready.
@@ -77,6 +81,12 @@ void wf::txn::transaction_t::apply(bool did_timeout)
     on_object_ready.disconnect();
 
     LOGC(TXN, "Applying transaction ", this, " timed_out: ", did_timeout);
+    TRACE_SCOPE(TXN, "apply-transaction");
+    if (did_timeout)
+    {
+        TRACE_ASYNC_INSTANT(TXN, "timeout", this);
+    }
+
     for (auto& obj : this->objects)
     {
         obj->apply();
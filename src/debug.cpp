@@ -361,6 +361,61 @@ std::ostream& wf::operator <<(std::ostream& out, wayfire_view view)
 
 std::bitset<(size_t)wf::log::logging_category::TOTAL> wf::log::enabled_categories;
 
+std::string_view wf::log::get_category_name(wf::log::logging_category category)
+{
+    switch (category)
+    {
+      case wf::log::logging_category::TXN:
+        return "txn";
+
+      case wf::log::logging_category::TXNI:
+        return "txni";
+
+      case wf::log::logging_category::VIEWS:
+        return "views";
+
+      case wf::log::logging_category::WLR:
+        return "wlroots";
+
+      case wf::log::logging_category::SCANOUT:
+        return "scanout";
+
+      case wf::log::logging_category::POINTER:
+        return "pointer";
+
+      case wf::log::logging_category::WSET:
+        return "wset";
+
+      case wf::log::logging_category::KBD:
+        return "kbd";
+
+      case wf::log::logging_category::XWL:
+        return "xwayland";
+
+      case wf::log::logging_category::LSHELL:
+        return "layer-shell";
+
+      case wf::log::logging_category::IM:
+        return "im";
+
+      case wf::log::logging_category::RENDER:
+        return "render";
+
+      case wf::log::logging_category::INPUT_DEVICES:
+        return "input-devices";
+
+      case wf::log::logging_category::OUTPUT:
+        return "output";
+
+      case wf::log::logging_category::IPC:
+        return "ipc";
+
+      default:
+        wf::dassert(false);
+        return "unknown";
+    }
+}
+
 wf::log::color_mode_t wf::detect_color_mode()
 {
     return isatty(STDOUT_FILENO) ? wf::log::LOG_COLOR_MODE_ON : wf::log::LOG_COLOR_MODE_OFF;
@@ -7,6 +7,7 @@
 
 #include <unistd.h>
 #include <wayfire/debug.hpp>
+#include <wayfire/trace.hpp>
 #include "main.hpp"
 
 #include <wayland-server.h>
@@ -45,6 +46,7 @@ static void print_help()
         std::endl;
     std::cout << " -R,  --damage-rerender   rerender damaged regions" << std::endl;
     std::cout << " -l,  --legacy-wl-drm     use legacy drm for wayland clients" << std::endl;
+    std::cout << " -T,  --trace [file]      record trace events, written to file on SIGUSR1" << std::endl;
     std::cout << " -v,  --version           print version and exit" << std::endl;
     exit(0);
 }
@@ -146,6 +148,19 @@ static void signal_handler(int signal)
     std::_Exit(-1);
 }
 
+static int handle_trace_flush_signal(int signal, void *data)
+{
+    if (wf::trace::enabled)
+    {
+        wf::trace::flush(wf::trace::get_default_path());
+    } else
+    {
+        LOGW("Received SIGUSR1, but tracing is not enabled.");
+    }
+
+    return 0;
+}
+
 static std::optional<std::string> choose_socket(wl_display *display)
 {
     for (int i = 1; i <= 32; i++)
@@ -183,58 +198,6 @@ static wf::config_backend_t *load_backend(const std::string& backend)
     return init();
 }
 
-static std::string_view get_category_name(wf::log::logging_category category)
-{
-    switch (category)
-    {
-      case wf::log::logging_category::TXN:
-        return "txn";
-
-      case wf::log::logging_category::TXNI:
-        return "txni";
-
-      case wf::log::logging_category::VIEWS:
-        return "views";
-
-      case wf::log::logging_category::WLR:
-        return "wlroots";
-
-      case wf::log::logging_category::SCANOUT:
-        return "scanout";
-
-      case wf::log::logging_category::POINTER:
-        return "pointer";
-
-      case wf::log::logging_category::WSET:
-        return "wset";
-
-      case wf::log::logging_category::KBD:
-        return "kbd";
-
-      case wf::log::logging_category::XWL:
-        return "xwayland";
-
-      case wf::log::logging_category::LSHELL:
-        return "layer-shell";
-
-      case wf::log::logging_category::IM:
-        return "im";
-
-      case wf::log::logging_category::RENDER:
-        return "render";
-
-      case wf::log::logging_category::INPUT_DEVICES:
-        return "input-devices";
-
-      case wf::log::logging_category::OUTPUT:
-        return "output";
-
-      default:
-        wf::dassert(false);
-        return "unknown";
-    }
-}
-
 void parse_extended_debugging(const std::vector<std::string>& categories)
 {
     for (const auto& cat : categories)
@@ -243,7 +206,7 @@ void parse_extended_debugging(const std::vector<std::string>& categories)
         const size_t total = (size_t)wf::log::logging_category::TOTAL;
         for (; idx < total; idx++)
         {
-            if (get_category_name((wf::log::logging_category)idx) == cat)
+            if (wf::log::get_category_name((wf::log::logging_category)idx) == cat)
             {
                 LOGD("Enabling debugging category \"", cat, "\"");
                 wf::log::enabled_categories.set(idx, 1);
@@ -291,6 +254,7 @@ int main(int argc, char *argv[])
         {"damage-debug", no_argument, NULL, 'D'},
         {"damage-rerender", no_argument, NULL, 'R'},
         {"legacy-wl-drm", no_argument, NULL, 'l'},
+        {"trace", optional_argument, NULL, 'T'},
         {"with-great-power-comes-great-responsibility", no_argument, NULL, 'r'},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
@@ -302,6 +266,7 @@ int main(int argc, char *argv[])
     std::string config_backend = WF_DEFAULT_CONFIG_BACKEND;
     std::vector<std::string> extended_debug_categories;
     bool allow_root = false;
+    bool enable_tracing = false;
 
     if (char *default_config_backend = getenv("WAYFIRE_DEFAULT_CONFIG_BACKEND"))
     {
@@ -314,7 +279,7 @@ int main(int argc, char *argv[])
     }
 
     int c, i;
-    while ((c = getopt_long(argc, argv, "c:B:d::DhRlrv", opts, &i)) != -1)
+    while ((c = getopt_long(argc, argv, "c:B:d::DhRlrT::v", opts, &i)) != -1)
     {
         switch (c)
         {
@@ -370,6 +335,23 @@ int main(int argc, char *argv[])
 
             break;
 
+          case 'T':
+            enable_tracing = true;
+            // Same as for -d, accept `-T file`.
+            if (!optarg && (NULL != argv[optind]) &&
+                ('-' != argv[optind][0]))
+            {
+                optarg = argv[optind];
+                ++optind;
+            }
+
+            if (optarg)
+            {
+                wf::trace::set_default_path(optarg);
+            }
+
+            break;
+
           case 'v':
             print_version_and_exit();
             break;
@@ -387,6 +369,11 @@ int main(int argc, char *argv[])
     wf::log::initialize_logging(std::cout, log_level, wf::detect_color_mode());
 
     parse_extended_debugging(extended_debug_categories);
+    if (enable_tracing)
+    {
+        wf::trace::set_enabled(true);
+    }
+
     wlr_log_init(WLR_DEBUG, wlr_log_handler);
 
 #ifdef PRINT_TRACE
@@ -419,6 +406,7 @@ int main(int argc, char *argv[])
     /** TODO: move this to core_impl constructor */
     core.display = display;
     core.ev_loop = wl_display_get_event_loop(core.display);
+    wl_event_loop_add_signal(core.ev_loop, SIGUSR1, handle_trace_flush_signal, nullptr);
     core.backend = wlr_backend_autocreate(core.ev_loop, &core.session);
 
     int drm_fd = -1;
@@ -0,0 +1,95 @@
+#include "frame-profiler.hpp"
+#include <wayfire/output.hpp>
+#include <algorithm>
+#include <sstream>
+
+// Divisor of the stall threshold below which operations are not recorded.
+static constexpr int64_t NOTABLE_FRACTION = 20;
+// Lists are trimmed to the most expensive entries when they grow beyond this size.
+static constexpr size_t MAX_PENDING_ENTRIES = 128;
+
+static void sort_and_trim(std::vector<wf::frame_stall_entry_t>& list, size_t max_entries)
+{
+    std::sort(list.begin(), list.end(), [] (const auto& a, const auto& b)
+    {
+        return a.duration > b.duration;
+    });
+
+    if (list.size() > max_entries)
+    {
+        list.resize(max_entries);
+    }
+}
+
+wf::frame_profiler_t& wf::frame_profiler_t::get()
+{
+    static frame_profiler_t profiler;
+    return profiler;
+}
+
+void wf::frame_profiler_t::begin_frame(int64_t threshold)
+{
+    active  = true;
+    current = {};
+    notable_duration = threshold / NOTABLE_FRACTION;
+}
+
+wf::frame_stall_report_t wf::frame_profiler_t::end_frame(size_t max_entries)
+{
+    active = false;
+    sort_and_trim(current.instances, max_entries);
+    sort_and_trim(current.hooks, max_entries);
+    sort_and_trim(current.passes, max_entries);
+    return std::move(current);
+}
+
+bool wf::frame_profiler_t::is_notable(int64_t duration) const
+{
+    return active && (duration >= notable_duration);
+}
+
+void wf::frame_profiler_t::add_entry(std::vector<frame_stall_entry_t>& list, frame_stall_entry_t entry)
+{
+    list.push_back(std::move(entry));
+    if (list.size() > 2 * MAX_PENDING_ENTRIES)
+    {
+        sort_and_trim(list, MAX_PENDING_ENTRIES);
+    }
+}
+
+void wf::frame_profiler_t::record_instance(const scene::render_instance_t *instance, const char *stage,
+    int64_t duration)
+{
+    if (is_notable(duration))
+    {
+        add_entry(current.instances, {instance->stringify(), stage, duration});
+    }
+}
+
+void wf::frame_profiler_t::record_hook(const std::string& name, output_effect_type_t type, int64_t duration)
+{
+    if (is_notable(duration))
+    {
+        add_entry(current.hooks, {name, wf::output_effect_type_to_string(type), duration});
+    }
+}
+
+void wf::frame_profiler_t::record_pass(const render_pass_params_t& params, size_t instructions,
+    int64_t duration)
+{
+    if (is_notable(duration))
+    {
+        auto size = params.target.get_size();
+        std::ostringstream name;
+        if (params.reference_output)
+        {
+            name << "output " << params.reference_output->to_string();
+        } else
+        {
+            name << "offscreen";
+        }
+
+        name << " " << size.width << "x" << size.height << ", " << instructions << " instructions";
+        add_entry(current.passes, {name.str(), "run", duration});
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <wayfire/render-manager.hpp>
+#include <wayfire/scene-render.hpp>
+
+namespace wf
+{
+/**
+ * Collects the cost of render instances, effect hooks and render passes while an output is painting a
+ * frame, so that frames which stall can be attributed to whatever made them slow.
+ *
+ * Timing an operation costs two clock reads. Operations are described (e.g. by stringifying the node of a
+ * render instance) only when they take long enough to be relevant for a stall report.
+ */
+class frame_profiler_t
+{
+  public:
+    static frame_profiler_t& get();
+
+    /**
+     * Start collecting data for a frame. Outputs are painted one after another, so frames do not nest.
+     *
+     * @param threshold The frame time in microseconds above which the frame counts as stalled.
+     */
+    void begin_frame(int64_t threshold);
+
+    /**
+     * Stop collecting data for the current frame.
+     *
+     * @param max_entries The maximal number of entries in each list of the report.
+     * @return The most expensive operations of the frame.
+     */
+    frame_stall_report_t end_frame(size_t max_entries);
+
+    /**
+     * @return Whether a frame is being profiled at the moment.
+     */
+    bool is_active() const
+    {
+        return active;
+    }
+
+    void record_instance(const scene::render_instance_t *instance, const char *stage, int64_t duration);
+    void record_hook(const std::string& name, output_effect_type_t type, int64_t duration);
+    void record_pass(const render_pass_params_t& params, size_t instructions, int64_t duration);
+
+  private:
+    bool active = false;
+    // Operations faster than this (in microseconds) cannot be a significant cause of a stall.
+    int64_t notable_duration = 0;
+    frame_stall_report_t current;
+
+    bool is_notable(int64_t duration) const;
+    void add_entry(std::vector<frame_stall_entry_t>& list, frame_stall_entry_t entry);
+};
+}
@@ -69,4 +69,10 @@ void update_focus_timestamp(wayfire_view view);
 
 void priv_render_manager_clear_instances(wf::render_manager *manager);
 void priv_render_manager_start_rendering(wf::render_manager *manager);
+
+/**
+ * Record in the frame timeline that the output's render instances were regenerated for @nodes nodes, which
+ * took @duration microseconds.
+ */
+void priv_render_manager_report_instance_regen(wf::render_manager *manager, int nodes, int64_t duration);
 }
@@ -0,0 +1,55 @@
+#include "paint-order.hpp"
+#include <wayfire/debug.hpp>
+#include <algorithm>
+
+wf::paint_order_queue_t& wf::paint_order_queue_t::get()
+{
+    static paint_order_queue_t queue;
+    return queue;
+}
+
+void wf::paint_order_queue_t::schedule(const void *key, int64_t latest_start, std::function<void()> paint)
+{
+    cancel(key);
+    pending.push_back({key, latest_start, std::move(paint)});
+    idle_dispatch.run_once([=] () { dispatch(); });
+}
+
+void wf::paint_order_queue_t::cancel(const void *key)
+{
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [&] (const pending_paint_t& paint)
+    {
+        return paint.key == key;
+    }), pending.end());
+}
+
+void wf::paint_order_queue_t::sort_by_deadline(std::vector<pending_paint_t>& paints, int64_t now)
+{
+    std::stable_sort(paints.begin(), paints.end(), [&] (const auto& a, const auto& b)
+    {
+        const bool a_late = a.latest_start < now;
+        const bool b_late = b.latest_start < now;
+        if (a_late != b_late)
+        {
+            return b_late;
+        }
+
+        // Among outputs which are late anyway, the least late one has the best chance to catch up.
+        return a_late ? (a.latest_start > b.latest_start) : (a.latest_start < b.latest_start);
+    });
+}
+
+void wf::paint_order_queue_t::dispatch()
+{
+    const int64_t now = wf::get_current_time_us();
+    sort_by_deadline(pending, now);
+
+    // Painting may cancel paints of other outputs (e.g. by destroying them), so take one paint at a time.
+    while (!pending.empty())
+    {
+        auto paint = std::move(pending.front());
+        pending.erase(pending.begin());
+        LOGC(RENDER, "Painting output in deadline order, slack ", paint.latest_start - now, "us.");
+        paint.paint();
+    }
+}
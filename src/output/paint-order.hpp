@@ -0,0 +1,57 @@
+#pragma once
+
+#include <wayfire/util.hpp>
+#include <functional>
+#include <vector>
+
+namespace wf
+{
+/**
+ * Orders the repaints of outputs which become ready at the same time.
+ *
+ * All outputs are painted one after another on the main thread, so an output which is expensive to paint
+ * delays every output painted after it. With core/paint_order set to `deadline`, outputs which become ready
+ * in the same event loop iteration (for example when one GPU reports the page flips of several outputs at
+ * once) are painted in order of the latest time at which they can start and still finish before their next
+ * vblank. Outputs which cannot make it anyway are painted last, so that they do not make the others miss
+ * their vblank too.
+ *
+ * The queue only changes the order of the paints, it does not paint outputs concurrently.
+ */
+class paint_order_queue_t
+{
+  public:
+    struct pending_paint_t
+    {
+        // Identifies the output, an output is queued at most once.
+        const void *key;
+        // The latest time (in microseconds) at which painting can start without missing the next vblank.
+        int64_t latest_start;
+        // The function which paints the output.
+        std::function<void()> paint;
+    };
+
+    static paint_order_queue_t& get();
+
+    /**
+     * Paint an output once the current event loop iteration is done.
+     */
+    void schedule(const void *key, int64_t latest_start, std::function<void()> paint);
+
+    /**
+     * Drop a queued paint, for example because the output is being destroyed.
+     */
+    void cancel(const void *key);
+
+    /**
+     * Sort @paints in the order in which they should be painted, when painting starts at @now.
+     */
+    static void sort_by_deadline(std::vector<pending_paint_t>& paints, int64_t now);
+
+  private:
+    std::vector<pending_paint_t> pending;
+    wf::wl_idle_call idle_dispatch;
+
+    void dispatch();
+};
+}
@@ -13,11 +13,20 @@
 #include "wayfire/view.hpp"
 #include "wayfire/output.hpp"
 #include "wayfire/util.hpp"
+#include "wayfire/trace.hpp"
 #include "../main.hpp"
+#include "frame-profiler.hpp"
+#include "paint-order.hpp"
 #include "wayfire/workspace-set.hpp" // IWYU pragma: keep
 #include <algorithm>
+#include <array>
+#include <cxxabi.h>
+#include <dlfcn.h>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <typeinfo>
+#include <unordered_map>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/util/log.hpp>
@@ -278,7 +287,7 @@ struct swapchain_damage_manager_t
         return next_frame;
     }
 
-    void swap_buffers(std::unique_ptr<frame_object_t> next_frame, const wf::region_t& swap_damage)
+    bool swap_buffers(std::unique_ptr<frame_object_t> next_frame, const wf::region_t& swap_damage)
     {
         /* If force frame sync option is set, call glFinish to block until
          * the GPU finishes rendering. This can work around some driver
@@ -299,14 +308,16 @@ struct swapchain_damage_manager_t
         if (!wlr_output_test_state(output, &next_frame->state))
         {
             LOGE("Output test failed!");
-            return;
+            return false;
         }
 
         if (!wlr_output_commit_state(output, &next_frame->state))
         {
             LOGE("Output commit failed!");
-            return;
+            return false;
         }
+
+        return true;
     }
 
     /**
@@ -387,6 +398,141 @@ struct swapchain_damage_manager_t
     }
 };
 
+static void hash_combine(size_t& hash, size_t value)
+{
+    hash ^= std::hash<size_t>{}(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+}
+
+const char *output_effect_type_to_string(output_effect_type_t type)
+{
+    switch (type)
+    {
+      case OUTPUT_EFFECT_PRE:
+        return "pre";
+
+      case OUTPUT_EFFECT_DAMAGE:
+        return "damage";
+
+      case OUTPUT_EFFECT_OVERLAY:
+        return "overlay";
+
+      case OUTPUT_EFFECT_PASS_DONE:
+        return "pass-done";
+
+      case OUTPUT_EFFECT_POST:
+        return "post";
+
+      default:
+        return "postprocess";
+    }
+}
+
+/**
+ * Find the name of the plugin whose code defines the given type, e.g. the lambda stored in a hook callback.
+ * Type information is emitted in the shared object which uses it, so libzoom.so results in "zoom".
+ * Types defined in the compositor itself result in "core".
+ */
+static std::string get_defining_plugin(const std::type_info& type)
+{
+    Dl_info info;
+    if (!dladdr(&type, &info) || !info.dli_fname)
+    {
+        return "unknown";
+    }
+
+    std::string file = std::filesystem::path(info.dli_fname).filename();
+    const std::string prefix = "lib";
+    const std::string suffix = ".so";
+    if ((file.size() > prefix.size() + suffix.size()) && (file.compare(0, prefix.size(), prefix) == 0) &&
+        (file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0))
+    {
+        return file.substr(prefix.size(), file.size() - prefix.size() - suffix.size());
+    }
+
+    return "core";
+}
+
+template<class Function>
+static std::string get_hook_name(const Function& hook, std::string name)
+{
+    if (!name.empty())
+    {
+        return name;
+    }
+
+    return hook ? get_defining_plugin(hook.target_type()) : "unknown";
+}
+
+/**
+ * Records how much time effect hooks and post effects take.
+ */
+struct hook_timings_t
+{
+    struct entry_t
+    {
+        hook_timing_t timing;
+        // The name of the hook's trace events, e.g. "pre-hook:expo" or "post-effect:zoom".
+        const char *trace_name = nullptr;
+    };
+
+    std::unordered_map<const void*, entry_t> timings;
+
+    void track(const void *hook, output_effect_type_t type, std::string name)
+    {
+        auto& entry = timings[hook];
+        entry.timing.hook = hook;
+        entry.timing.type = type;
+        entry.timing.name = std::move(name);
+        const std::string prefix = (type == OUTPUT_EFFECT_TOTAL) ? "post-effect" :
+            std::string(output_effect_type_to_string(type)) + "-hook";
+        entry.trace_name = wf::trace::intern(prefix + ":" + entry.timing.name);
+    }
+
+    void forget(const void *hook)
+    {
+        timings.erase(hook);
+    }
+
+    /**
+     * @return The name of the hook's trace events, or nullptr if the hook is not tracked.
+     */
+    const char *get_trace_name(const void *hook) const
+    {
+        auto it = timings.find(hook);
+        return (it == timings.end()) ? nullptr : it->second.trace_name;
+    }
+
+    /**
+     * Record a run of a hook. Hooks which are not tracked (e.g. because they removed themselves while
+     * running) are ignored.
+     *
+     * @return The timing of the hook, or nullptr if it is not tracked.
+     */
+    const hook_timing_t *record(const void *hook, int64_t duration)
+    {
+        auto it = timings.find(hook);
+        if (it == timings.end())
+        {
+            return nullptr;
+        }
+
+        auto& timing = it->second.timing;
+        timing.last    = duration;
+        timing.max     = std::max(timing.max, duration);
+        timing.average = timing.calls ? (0.9 * timing.average + 0.1 * duration) : duration;
+        timing.calls++;
+        return &timing;
+    }
+
+    void append_to(std::vector<hook_timing_t>& result) const
+    {
+        for (auto& [_, entry] : timings)
+        {
+            result.push_back(entry.timing);
+        }
+    }
+};
+
 /**
  * Very simple class to manage effect hooks
  */
@@ -394,10 +540,12 @@ struct effect_hook_manager_t
 {
     using effect_container_t = wf::safe_list_t<effect_hook_t*>;
     effect_container_t effects[OUTPUT_EFFECT_TOTAL];
+    hook_timings_t timings;
 
-    void add_effect(effect_hook_t *hook, output_effect_type_t type)
+    void add_effect(effect_hook_t *hook, output_effect_type_t type, std::string name)
     {
         effects[type].push_back(hook);
+        timings.track(hook, type, get_hook_name(*hook, std::move(name)));
     }
 
     bool can_scanout() const
@@ -412,12 +560,37 @@ struct effect_hook_manager_t
         {
             effects[i].remove_all(hook);
         }
+
+        timings.forget(hook);
     }
 
     void run_effects(output_effect_type_t type)
     {
-        effects[type].for_each([] (auto effect)
-        { (*effect)(); });
+        effects[type].for_each([&] (auto effect)
+        {
+            TRACE_SCOPE(RENDER, timings.get_trace_name(effect));
+            const int64_t start = wf::get_current_time_us();
+            (*effect)();
+            const int64_t duration = wf::get_current_time_us() - start;
+            if (auto timing = timings.record(effect, duration))
+            {
+                frame_profiler_t::get().record_hook(timing->name, type, duration);
+            }
+        });
+    }
+
+    /**
+     * Mix the currently registered hooks into @hash.
+     */
+    void hash_hooks(size_t& hash)
+    {
+        for (int i = 0; i < OUTPUT_EFFECT_TOTAL; i++)
+        {
+            effects[i].for_each([&] (auto effect)
+            {
+                hash_combine(hash, (size_t)effect + i);
+            });
+        }
     }
 };
 
@@ -426,17 +599,51 @@ struct effect_hook_manager_t
  */
 struct postprocessing_manager_t
 {
-    using post_container_t = wf::safe_list_t<post_hook_t*>;
+    /* A post effect is either a post hook or a fusible effect */
+    struct post_entry_t
+    {
+        post_hook_t *hook = nullptr;
+        fusible_post_effect_t *fusible = nullptr;
+        post_effect_dependencies_t dependencies;
+
+        bool operator ==(const post_entry_t& other) const
+        {
+            return hook == other.hook && fusible == other.fusible;
+        }
+    };
+
+    using post_container_t = wf::safe_list_t<post_entry_t>;
     post_container_t post_effects;
     wf::auxilliary_buffer_t post_buffers[2];
     /* Buffer to which other operations render to */
     static constexpr uint32_t default_out_buffer = 0;
 
+    /* Compiled programs for the combinations of consecutive fusible effects which were used */
+    std::map<std::vector<fusible_post_effect_t*>, OpenGL::program_t> fused_programs;
+    /* Fusible effects removed since the last frame, whose programs need to be freed */
+    std::vector<fusible_post_effect_t*> removed_fusible;
+    hook_timings_t timings;
+
     output_t *output;
     uint32_t output_width, output_height;
     postprocessing_manager_t(output_t *output)
     {
         this->output = output;
+        for (auto& buffer : post_buffers)
+        {
+            buffer.set_owner("postprocessing: " + output->to_string());
+        }
+    }
+
+    ~postprocessing_manager_t()
+    {
+        wf::gles::run_in_context_if_gles([&]
+        {
+            for (auto& [_, program] : fused_programs)
+            {
+                program.free_resources();
+            }
+        });
     }
 
     wf::render_buffer_t final_target;
@@ -450,6 +657,7 @@ struct postprocessing_manager_t
 
     void allocate(int width, int height)
     {
+        free_removed_programs();
         if (post_effects.size() == 0)
         {
             return;
@@ -463,15 +671,34 @@ struct postprocessing_manager_t
         }
     }
 
-    void add_post(post_hook_t *hook)
+    void add_post(post_hook_t *hook, post_effect_dependencies_t dependencies, std::string name)
     {
-        post_effects.push_back(hook);
+        post_effects.push_back({.hook = hook, .dependencies = std::move(dependencies)});
+        timings.track(hook, OUTPUT_EFFECT_TOTAL, get_hook_name(*hook, std::move(name)));
         output->render->damage_whole_idle();
     }
 
     void rem_post(post_hook_t *hook)
     {
-        post_effects.remove_all(hook);
+        post_effects.remove_all({.hook = hook});
+        timings.forget(hook);
+        output->render->damage_whole_idle();
+    }
+
+    void add_post(fusible_post_effect_t *effect, post_effect_dependencies_t dependencies, std::string name)
+    {
+        post_effects.push_back({.fusible = effect, .dependencies = std::move(dependencies)});
+        // The snippets are plain strings, so the plugin is found through the uniform callback.
+        timings.track(effect, OUTPUT_EFFECT_TOTAL, get_hook_name(effect->set_uniforms, std::move(name)));
+        output->render->damage_whole_idle();
+    }
+
+    void rem_post(fusible_post_effect_t *effect)
+    {
+        post_effects.remove_all({.fusible = effect});
+        timings.forget(effect);
+        // The effect might be removed while its program is in use, so free the program on the next frame.
+        removed_fusible.push_back(effect);
         output->render->damage_whole_idle();
     }
 
@@ -484,14 +711,226 @@ struct postprocessing_manager_t
     void run_post_effects()
     {
         int cur_idx = 0;
+        std::vector<fusible_post_effect_t*> pending_fusible;
+        auto run_pending_fusible = [&] (bool last)
+        {
+            int next_idx = 1 - cur_idx;
+            wf::render_buffer_t dst_buffer = (last ? final_target : post_buffers[next_idx].get_renderbuffer());
+            TRACE_SCOPE(RENDER, "fused-post-effects");
+            const int64_t start = wf::get_current_time_us();
+            run_fused_effects(pending_fusible, post_buffers[cur_idx], dst_buffer);
+            const int64_t duration = wf::get_current_time_us() - start;
+            for (auto effect : pending_fusible)
+            {
+                if (auto timing = timings.record(effect, duration))
+                {
+                    frame_profiler_t::get().record_hook(timing->name, OUTPUT_EFFECT_TOTAL, duration);
+                }
+            }
+
+            pending_fusible.clear();
+            cur_idx = next_idx;
+        };
+
         post_effects.for_each([&] (auto post) -> void
         {
+            if (post.fusible)
+            {
+                pending_fusible.push_back(post.fusible);
+                return;
+            }
+
+            if (!pending_fusible.empty())
+            {
+                run_pending_fusible(false);
+            }
+
             int next_idx = 1 - cur_idx;
             wf::render_buffer_t dst_buffer = (post == post_effects.back() ?
                 final_target : post_buffers[next_idx].get_renderbuffer());
-            (*post)(post_buffers[cur_idx], dst_buffer);
+            TRACE_SCOPE(RENDER, timings.get_trace_name(post.hook));
+            const int64_t start = wf::get_current_time_us();
+            (*post.hook)(post_buffers[cur_idx], dst_buffer);
+            const int64_t duration = wf::get_current_time_us() - start;
+            if (auto timing = timings.record(post.hook, duration))
+            {
+                frame_profiler_t::get().record_hook(timing->name, OUTPUT_EFFECT_TOTAL, duration);
+            }
             cur_idx = next_idx;
         });
+
+        if (!pending_fusible.empty())
+        {
+            run_pending_fusible(true);
+        }
+    }
+
+    /**
+     * Generate the fragment shader which applies the given fusible effects in order.
+     * The sample transforms are applied from the last effect to the first, because each effect samples the
+     * output of the previous one. The color transforms are applied from the first effect to the last.
+     */
+    static std::string generate_fused_shader(const std::vector<fusible_post_effect_t*>& effects)
+    {
+        std::string declarations;
+        std::string sample_calls;
+        std::string color_calls;
+        for (size_t i = 0; i < effects.size(); i++)
+        {
+            const auto& effect = *effects[i];
+            const std::string idx = std::to_string(i);
+            declarations += effect.declarations + "\n";
+            if (!effect.sample_transform.empty())
+            {
+                declarations += "highp vec2 _wf_fused_sample_" + idx + "(highp vec2 uv)\n{\n" +
+                    effect.sample_transform + "\n}\n";
+                sample_calls = "    uv = _wf_fused_sample_" + idx + "(uv);\n" + sample_calls;
+            }
+
+            if (!effect.color_transform.empty())
+            {
+                declarations += "highp vec4 _wf_fused_color_" + idx + "(highp vec4 color)\n{\n" +
+                    effect.color_transform + "\n}\n";
+                color_calls += "    color = _wf_fused_color_" + idx + "(color);\n";
+            }
+        }
+
+        return "#version 100\n"
+               "precision highp float;\n"
+               "varying highp vec2 uvpos;\n"
+               "uniform sampler2D smp;\n" +
+               declarations +
+               "void main()\n{\n"
+               "    highp vec2 uv = uvpos;\n" +
+               sample_calls +
+               "    highp vec4 color = texture2D(smp, uv);\n" +
+               color_calls +
+               "    gl_FragColor = color;\n}\n";
+    }
+
+    OpenGL::program_t& get_fused_program(const std::vector<fusible_post_effect_t*>& effects)
+    {
+        static const char *vertex_shader =
+            R"(
+#version 100
+
+attribute highp vec2 position;
+attribute highp vec2 uvPosition;
+
+varying highp vec2 uvpos;
+
+void main() {
+
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+    uvpos = uvPosition;
+}
+)";
+
+        auto it = fused_programs.find(effects);
+        if (it != fused_programs.end())
+        {
+            return it->second;
+        }
+
+        LOGC(RENDER, "Output ", output->to_string(), ": compiling fused program for ", effects.size(),
+            " post effects.");
+        auto& program = fused_programs[effects];
+        program.set_simple(OpenGL::compile_program(vertex_shader, generate_fused_shader(effects)));
+        return program;
+    }
+
+    void run_fused_effects(const std::vector<fusible_post_effect_t*>& effects,
+        wf::auxilliary_buffer_t& source, const wf::render_buffer_t& destination)
+    {
+        static const float vertex_data[] = {
+            -1.0f, -1.0f,
+            1.0f, -1.0f,
+            1.0f, 1.0f,
+            -1.0f, 1.0f
+        };
+
+        static const float coord_data[] = {
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            1.0f, 1.0f,
+            0.0f, 1.0f
+        };
+
+        bool applied = false;
+        wf::gles::run_in_context_if_gles([&]
+        {
+            auto& program = get_fused_program(effects);
+            if (!program.get_program_id(wf::TEXTURE_TYPE_RGBA))
+            {
+                // Compilation failed, the error has already been logged.
+                return;
+            }
+
+            applied = true;
+
+            wf::gles::bind_render_buffer(destination);
+            program.use(wf::TEXTURE_TYPE_RGBA);
+            GL_CALL(glActiveTexture(GL_TEXTURE0));
+            GL_CALL(glBindTexture(GL_TEXTURE_2D, wf::gles_texture_t::from_aux(source).tex_id));
+
+            program.attrib_pointer("position", 2, 0, vertex_data);
+            program.attrib_pointer("uvPosition", 2, 0, coord_data);
+            for (auto effect : effects)
+            {
+                if (effect->set_uniforms)
+                {
+                    effect->set_uniforms(program, destination.get_size());
+                }
+            }
+
+            GL_CALL(glDisable(GL_BLEND));
+            GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+            GL_CALL(glEnable(GL_BLEND));
+            GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+            program.deactivate();
+        });
+
+        if (!applied)
+        {
+            // The effects cannot be applied without a GLES renderer or if their shader did not compile.
+            // Pass the image through unchanged, otherwise the following effects and the output would
+            // show stale contents of the destination buffer.
+            auto size = source.get_size();
+            destination.blit(source, {0, 0, (double)size.width, (double)size.height},
+                {0, 0, destination.get_size().width, destination.get_size().height});
+        }
+    }
+
+    void free_removed_programs()
+    {
+        if (removed_fusible.empty())
+        {
+            return;
+        }
+
+        wf::gles::run_in_context_if_gles([&]
+        {
+            for (auto it = fused_programs.begin(); it != fused_programs.end();)
+            {
+                const bool uses_removed = std::any_of(it->first.begin(), it->first.end(),
+                    [&] (fusible_post_effect_t *effect)
+                {
+                    return std::find(removed_fusible.begin(), removed_fusible.end(),
+                        effect) != removed_fusible.end();
+                });
+
+                if (uses_removed)
+                {
+                    it->second.free_resources();
+                    it = fused_programs.erase(it);
+                } else
+                {
+                    ++it;
+                }
+            }
+        });
+
+        removed_fusible.clear();
     }
 
     wf::render_target_t get_target_framebuffer() const
@@ -511,6 +950,76 @@ struct postprocessing_manager_t
     {
         return post_effects.size() == 0;
     }
+
+    /**
+     * @return Whether the output of any effect depends on the pointer position.
+     */
+    bool depends_on_pointer()
+    {
+        bool result = false;
+        post_effects.for_each([&] (auto post)
+        {
+            result |= post.dependencies.pointer;
+        });
+
+        return result;
+    }
+
+    /**
+     * @return Whether any effect needs to be repainted on the next frame.
+     */
+    bool is_animating()
+    {
+        bool result = false;
+        post_effects.for_each([&] (auto post)
+        {
+            result |= (post.dependencies.animating && post.dependencies.animating());
+        });
+
+        return result;
+    }
+
+    /**
+     * Transform the damage of the main render pass through all effects, in buffer-local coordinates.
+     * Effects which cannot transform damage damage the whole @extents.
+     */
+    wf::region_t transform_damage(wf::region_t damage, const wlr_box& extents)
+    {
+        bool full_damage = false;
+        post_effects.for_each([&] (auto post)
+        {
+            if (full_damage)
+            {
+                return;
+            }
+
+            if (post.dependencies.transform_damage)
+            {
+                damage = post.dependencies.transform_damage(damage);
+            } else if (!post.fusible || !post.fusible->sample_transform.empty())
+            {
+                full_damage = true;
+            }
+        });
+
+        if (full_damage)
+        {
+            return extents;
+        }
+
+        return damage & extents;
+    }
+
+    /**
+     * Mix the currently registered post hooks into @hash.
+     */
+    void hash_hooks(size_t& hash)
+    {
+        post_effects.for_each([&] (auto post)
+        {
+            hash_combine(hash, post.hook ? (size_t)post.hook : (size_t)post.fusible);
+        });
+    }
 };
 
 /**
@@ -659,6 +1168,12 @@ class depth_buffer_manager_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, if core/repaint_scheduler is set to `render-time`, the delay
+ * is calculated from the measured (CPU + GPU) render time of recent frames:
+ * delay = refresh - p95(render time) - core/repaint_safety_margin.
+ * Since render times depend heavily on the active effects, samples are kept
+ * separately for each set of hooks registered on the output.
  */
 struct repaint_delay_manager_t
 {
@@ -714,82 +1229,379 @@ struct repaint_delay_manager_t
                 --expand_inc_window_on_miss;
             }
 
-            // Stop exponential decrease
-            consecutive_decrease = 1;
+            // Stop exponential decrease
+            consecutive_decrease = 1;
+        } else
+        {
+            // We missed last frame.
+            update_delay(-consecutive_decrease);
+            // Next decrease should be faster
+            consecutive_decrease = clamp(consecutive_decrease * 2, 1, 32);
+
+            // Next increase should be tried after a longer interval
+            if (expand_inc_window_on_miss >= 0)
+            {
+                increase_window = clamp(increase_window * 2,
+                    MIN_INCREASE_WINDOW, MAX_INCREASE_WINDOW);
+            }
+
+            reset_increase_timer();
+        }
+
+        last_pageflip = get_current_time();
+    }
+
+    /**
+     * @return The delay in milliseconds for the current frame.
+     */
+    int get_delay()
+    {
+        if (use_render_time())
+        {
+            return get_render_time_delay();
+        }
+
+        return delay;
+    }
+
+    /**
+     * @return Whether the render-time based scheduler is active, i.e. whether render times should be
+     *   reported via report_render_time().
+     */
+    bool use_render_time() const
+    {
+        return scheduler.value() == "render-time";
+    }
+
+    /**
+     * Set the key identifying the set of active effects for the next frames.
+     */
+    void set_effect_set(size_t key)
+    {
+        current_set = key;
+    }
+
+    /**
+     * Add the render time of a frame rendered with the effect set @key, in microseconds.
+     */
+    void report_render_time(size_t key, int64_t render_time)
+    {
+        if (!render_times.count(key) && (render_times.size() >= MAX_EFFECT_SETS))
+        {
+            // Forget the effect sets we have seen so far, they are likely not used anymore.
+            render_times.clear();
+        }
+
+        render_times[key].add(render_time);
+    }
+
+  private:
+    int delay = 0;
+
+    /**
+     * A sliding window of render times with a percentile estimate.
+     */
+    struct render_time_window_t
+    {
+        static constexpr size_t WINDOW_SIZE = 120;
+        std::array<int64_t, WINDOW_SIZE> samples;
+        size_t count = 0;
+        size_t next  = 0;
+
+        void add(int64_t sample)
+        {
+            samples[next] = sample;
+            next  = (next + 1) % WINDOW_SIZE;
+            count = std::min(count + 1, WINDOW_SIZE);
+        }
+
+        int64_t percentile(double p) const
+        {
+            std::array<int64_t, WINDOW_SIZE> sorted;
+            std::copy(samples.begin(), samples.begin() + count, sorted.begin());
+            auto nth = sorted.begin() + std::min(count - 1, (size_t)(count * p));
+            std::nth_element(sorted.begin(), nth, sorted.begin() + count);
+            return *nth;
+        }
+    };
+
+    // Minimal amount of samples before we trust the estimate for an effect set.
+    static constexpr size_t MIN_SAMPLES     = 10;
+    static constexpr size_t MAX_EFFECT_SETS = 16;
+    std::unordered_map<size_t, render_time_window_t> render_times;
+    size_t current_set = 0;
+
+    int get_render_time_delay()
+    {
+        auto it = render_times.find(current_set);
+        if ((it == render_times.end()) || (it->second.count < MIN_SAMPLES) || (refresh_nsec <= 0))
+        {
+            return 0;
+        }
+
+        const int64_t refresh = refresh_nsec / 1000;
+        const int64_t budget  = refresh - it->second.percentile(0.95) - safety_margin * 1000;
+        // Always leave at least one millisecond for rendering
+        return clamp((int)(budget / 1000), 0, std::max(0, (int)(refresh / 1000) - 1));
+    }
+
+    void update_delay(int delta)
+    {
+        int config_delay = std::max(0,
+            (int)(this->refresh_nsec / 1e6) - max_render_time);
+
+        int min = 0;
+        int max = config_delay;
+        if (max_render_time == -1)
+        {
+            max = 0;
+        } else if (!dynamic_delay)
+        {
+            min = config_delay;
+            max = config_delay;
+        }
+
+        delay = clamp(delay + delta, min, max);
+    }
+
+    void reset_increase_timer()
+    {
+        last_increase = get_current_time();
+    }
+
+    static constexpr int64_t MIN_INCREASE_WINDOW = 200; // 200 ms
+    static constexpr int64_t MAX_INCREASE_WINDOW = 30'000; // 30s
+    int64_t increase_window = MIN_INCREASE_WINDOW;
+    int64_t last_increase   = 0;
+
+    // > 0 => Increase increase_window
+    int64_t expand_inc_window_on_miss = 0;
+
+    // Expontential decrease in case of missed frames
+    int32_t consecutive_decrease = 1;
+
+    // Time of last frame
+    int64_t last_pageflip = -1; // -1 is invalid
+
+    int64_t refresh_nsec = 0;
+    wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
+    wf::option_wrapper_t<std::string> scheduler{"core/repaint_scheduler"};
+    wf::option_wrapper_t<int> safety_margin{"core/repaint_safety_margin"};
+    wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+
+    wf::wl_listener_wrapper on_present;
+};
+
+/**
+ * Compares the time needed to paint each frame with the frame budget, and asks plugins to reduce their
+ * rendering quality when the budget is exceeded repeatedly, or to increase it again when there is enough
+ * headroom.
+ */
+struct frame_budget_manager_t
+{
+    // Number of consecutive frames over budget before reducing quality
+    static constexpr int STEP_DOWN_FRAMES = 5;
+    // Number of consecutive frames with headroom before increasing quality again
+    static constexpr int STEP_UP_FRAMES = 120;
+    // A frame has headroom if it takes less than this fraction of the budget
+    static constexpr double HEADROOM = 0.7;
+
+    wf::option_wrapper_t<double> frame_budget{"core/frame_budget"};
+    wf::safe_list_t<quality_callback_t*> callbacks;
+    wf::output_t *output;
+    int reduction = 0;
+
+    frame_budget_manager_t(wf::output_t *output)
+    {
+        this->output = output;
+        frame_budget.set_callback([=] ()
+        {
+            if (frame_budget <= 0)
+            {
+                // Budget disabled, restore full quality.
+                for (; reduction > 0 && step(false); --reduction)
+                {}
+
+                reduction = 0;
+            }
+        });
+    }
+
+    void add_callback(quality_callback_t *callback)
+    {
+        callbacks.push_back(callback);
+    }
+
+    void rem_callback(quality_callback_t *callback)
+    {
+        callbacks.remove_all(callback);
+    }
+
+    /**
+     * Report the time it took to paint a frame, in microseconds.
+     */
+    void report_frame(int64_t frame_time)
+    {
+        if ((frame_budget <= 0) || (callbacks.size() == 0))
+        {
+            over_budget = with_headroom = 0;
+            return;
+        }
+
+        const double budget = frame_budget * 1000.0;
+        if (frame_time > budget)
+        {
+            ++over_budget;
+            with_headroom = 0;
+        } else if (frame_time < budget * HEADROOM)
+        {
+            ++with_headroom;
+            over_budget = 0;
         } else
         {
-            // We missed last frame.
-            update_delay(-consecutive_decrease);
-            // Next decrease should be faster
-            consecutive_decrease = clamp(consecutive_decrease * 2, 1, 32);
+            over_budget = with_headroom = 0;
+        }
 
-            // Next increase should be tried after a longer interval
-            if (expand_inc_window_on_miss >= 0)
+        if (over_budget >= STEP_DOWN_FRAMES)
+        {
+            over_budget = 0;
+            if (step(true))
             {
-                increase_window = clamp(increase_window * 2,
-                    MIN_INCREASE_WINDOW, MAX_INCREASE_WINDOW);
+                ++reduction;
+            }
+        } else if ((with_headroom >= STEP_UP_FRAMES) && (reduction > 0))
+        {
+            with_headroom = 0;
+            if (step(false))
+            {
+                --reduction;
             }
-
-            reset_increase_timer();
         }
-
-        last_pageflip = get_current_time();
     }
 
+  private:
+    int over_budget   = 0;
+    int with_headroom = 0;
+
     /**
-     * @return The delay in milliseconds for the current frame.
+     * Ask all plugins to change their quality by one step.
+     * @return Whether any plugin changed its quality.
      */
-    int get_delay()
+    bool step(bool reduce)
     {
-        return delay;
+        bool changed = false;
+        callbacks.for_each([&] (auto callback)
+        {
+            changed |= (*callback)(reduce);
+        });
+
+        LOGC(RENDER, "Output ", output->to_string(), ": ", reduce ? "reducing" : "increasing",
+            " rendering quality, changed: ", changed ? "yes" : "no", ".");
+        return changed;
     }
+};
 
-  private:
-    int delay = 0;
+/**
+ * Records timing information about the last few repaint cycles of an output in a ring buffer.
+ */
+struct frame_timeline_t
+{
+    static constexpr size_t MAX_FRAMES = 256;
 
-    void update_delay(int delta)
+    frame_timeline_t(wf::output_t *output)
     {
-        int config_delay = std::max(0,
-            (int)(this->refresh_nsec / 1e6) - max_render_time);
-
-        int min = 0;
-        int max = config_delay;
-        if (max_render_time == -1)
-        {
-            max = 0;
-        } else if (!dynamic_delay)
+        on_present.set_callback([&] (void *data)
         {
-            min = config_delay;
-            max = config_delay;
-        }
-
-        delay = clamp(delay + delta, min, max);
+            auto ev = static_cast<wlr_output_event_present*>(data);
+            handle_present(ev);
+        });
+        on_present.connect(&output->handle->events.present);
     }
 
-    void reset_increase_timer()
+    /**
+     * The backend requested a new frame.
+     */
+    void frame_event()
     {
-        last_increase = get_current_time();
+        last_frame_event = wf::get_current_time_us();
     }
 
-    static constexpr int64_t MIN_INCREASE_WINDOW = 200; // 200 ms
-    static constexpr int64_t MAX_INCREASE_WINDOW = 30'000; // 30s
-    int64_t increase_window = MIN_INCREASE_WINDOW;
-    int64_t last_increase   = 0;
+    /**
+     * The render instances of the output were regenerated. Counted towards the next frame.
+     */
+    void report_instance_regen(int nodes, int64_t duration)
+    {
+        pending_regen.instance_regens++;
+        pending_regen.regenerated_nodes += nodes;
+        pending_regen.regen_time += duration;
+    }
 
-    // > 0 => Increase increase_window
-    int64_t expand_inc_window_on_miss = 0;
+    /**
+     * A new repaint cycle starts. The returned timing is valid until the next call to start_frame().
+     */
+    frame_timing_t& start_frame()
+    {
+        auto& frame = frames[total % MAX_FRAMES];
+        frame = {};
+        frame.seq   = total++;
+        frame.frame_event = last_frame_event;
+        frame.start = wf::get_current_time_us();
+        frame.instance_regens   = pending_regen.instance_regens;
+        frame.regenerated_nodes = pending_regen.regenerated_nodes;
+        frame.regen_time = pending_regen.regen_time;
+        pending_regen    = {};
+        last_frame_event = -1;
+        return frame;
+    }
 
-    // Expontential decrease in case of missed frames
-    int32_t consecutive_decrease = 1;
+    /**
+     * Mark the end of the given phase in the current frame.
+     */
+    void mark(frame_phase_t phase)
+    {
+        if (total > 0)
+        {
+            frames[(total - 1) % MAX_FRAMES].phase_end[phase] = wf::get_current_time_us();
+        }
+    }
 
-    // Time of last frame
-    int64_t last_pageflip = -1; // -1 is invalid
+    std::vector<frame_timing_t> get_frames() const
+    {
+        const size_t count = std::min<uint64_t>(total, MAX_FRAMES);
+        std::vector<frame_timing_t> result;
+        result.reserve(count);
+        for (uint64_t i = total - count; i < total; i++)
+        {
+            result.push_back(frames[i % MAX_FRAMES]);
+        }
 
-    int64_t refresh_nsec;
-    wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
-    wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+        return result;
+    }
 
+  private:
+    std::array<frame_timing_t, MAX_FRAMES> frames;
+    uint64_t total = 0;
+    int64_t last_frame_event = -1;
+    frame_timing_t pending_regen;
     wf::wl_listener_wrapper on_present;
+
+    void handle_present(wlr_output_event_present *ev)
+    {
+        const size_t count = std::min<uint64_t>(total, MAX_FRAMES);
+        for (uint64_t i = total; i > total - count; i--)
+        {
+            auto& frame = frames[(i - 1) % MAX_FRAMES];
+            const bool committed = (frame.result == frame_result_t::RENDERED) ||
+                (frame.result == frame_result_t::SCANOUT);
+            if (committed && (frame.commit_seq == ev->commit_seq))
+            {
+                frame.discarded    = !ev->presented;
+                frame.presented    = ev->presented ? wf::timespec_to_usec(ev->when) : -1;
+                frame.refresh_nsec = ev->refresh;
+                return;
+            }
+        }
+    }
 };
 
 class wf::render_manager::impl
@@ -805,10 +1617,26 @@ class wf::render_manager::impl
     std::unique_ptr<postprocessing_manager_t> postprocessing;
     std::unique_ptr<depth_buffer_manager_t> depth_buffer_manager;
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
+    std::unique_ptr<frame_timeline_t> timeline;
+    std::unique_ptr<frame_budget_manager_t> budget;
 
     wf::option_wrapper_t<wf::color_t> background_color_opt;
     std::unique_ptr<wf::render_pass_t> current_pass;
     wf::option_wrapper_t<std::string> icc_profile;
+    wf::option_wrapper_t<double> damage_coalesce_threshold{"core/damage_coalesce_threshold"};
+    wf::option_wrapper_t<int> frame_stall_threshold{"core/frame_stall_threshold"};
+    wf::option_wrapper_t<std::string> paint_order{"core/paint_order"};
+
+    // When the last frame event was received, in microseconds.
+    int64_t last_frame_event = 0;
+    // Moving average of the time needed to paint a frame, in microseconds.
+    int64_t expected_paint_time = 0;
+
+    // The name of the trace events for painting the output.
+    const char *paint_trace_name;
+
+    // The number of entries of each kind in a frame stall report.
+    static constexpr size_t FRAME_STALL_ENTRIES = 5;
 
     wlr_color_transform *get_color_transform()
     {
@@ -822,6 +1650,9 @@ class wf::render_manager::impl
         postprocessing = std::make_unique<postprocessing_manager_t>(o);
         depth_buffer_manager = std::make_unique<depth_buffer_manager_t>();
         delay_manager = std::make_unique<repaint_delay_manager_t>(o);
+        timeline = std::make_unique<frame_timeline_t>(o);
+        paint_trace_name = wf::trace::intern("paint " + o->to_string());
+        budget   = std::make_unique<frame_budget_manager_t>(o);
 
         on_frame.set_callback([&] (void*)
         {
@@ -832,6 +1663,9 @@ class wf::render_manager::impl
                 return;
             }
 
+            timeline->frame_event();
+            last_frame_event = wf::get_current_time_us();
+            delay_manager->set_effect_set(get_effect_set());
             delay_manager->start_frame();
 
             auto repaint_delay = delay_manager->get_delay();
@@ -840,14 +1674,14 @@ class wf::render_manager::impl
             if (repaint_delay < 1)
             {
                 output->handle->frame_pending = false;
-                paint();
+                request_paint();
             } else
             {
                 output->handle->frame_pending = true;
                 repaint_timer.set_timeout(repaint_delay, [=] ()
                 {
                     output->handle->frame_pending = false;
-                    paint();
+                    request_paint();
                 });
             }
 
@@ -856,6 +1690,11 @@ class wf::render_manager::impl
         });
 
         on_frame.connect(&output->handle->events.frame);
+        wf::get_core().connect(&on_pointer_motion);
+        wf::get_core().connect(&on_pointer_motion_absolute);
+        wf::get_core().connect(&on_tablet_tip);
+        wf::get_core().connect(&on_tablet_axis);
+        wf::get_core().connect(&on_tablet_proximity);
 
         background_color_opt.load_option("core/background_color");
         background_color_opt.set_callback([=] ()
@@ -928,7 +1767,86 @@ class wf::render_manager::impl
 
     ~impl()
     {
+        paint_order_queue_t::get().cancel(this);
         set_icc_transform(nullptr);
+        if (render_timer)
+        {
+            wlr_render_timer_destroy(render_timer);
+        }
+    }
+
+    /* GPU timer for the main render pass, used by the render-time repaint scheduler. */
+    wlr_render_timer *render_timer = NULL;
+    bool render_timer_unsupported  = false;
+    /* CPU render time of the last frame whose GPU time has not been read yet, or -1. */
+    int64_t pending_cpu_time  = -1;
+    size_t pending_effect_set = 0;
+
+    /**
+     * Compute a key for the set of effects currently active on the output.
+     */
+    size_t get_effect_set()
+    {
+        size_t hash = 0;
+        effects->hash_hooks(hash);
+        postprocessing->hash_hooks(hash);
+        return hash;
+    }
+
+    /**
+     * Collect the GPU time of the previous frame and get the timer for the next render pass.
+     */
+    wlr_render_timer *prepare_render_timer()
+    {
+        if (!delay_manager->use_render_time())
+        {
+            pending_cpu_time = -1;
+            return NULL;
+        }
+
+        if (render_timer && (pending_cpu_time >= 0))
+        {
+            // The previous frame has been presented already, so reading the timer does not stall.
+            int gpu_time = wlr_render_timer_get_duration_ns(render_timer);
+            delay_manager->report_render_time(pending_effect_set,
+                pending_cpu_time + std::max(gpu_time, 0) / 1000);
+            pending_cpu_time = -1;
+        }
+
+        if (!render_timer && !render_timer_unsupported)
+        {
+            render_timer = wlr_render_timer_create(output->handle->renderer);
+            if (!render_timer)
+            {
+                LOGC(RENDER, "GPU timers are not supported on output ", output->to_string(),
+                    ", using only CPU render time for repaint scheduling.");
+                render_timer_unsupported = true;
+            }
+        }
+
+        return render_timer;
+    }
+
+    /**
+     * Report the render time of a finished frame to the repaint scheduler.
+     */
+    void report_render_time(const frame_timing_t& frame)
+    {
+        if (!delay_manager->use_render_time() || (frame.result != frame_result_t::RENDERED))
+        {
+            return;
+        }
+
+        const int64_t cpu_time = frame.phase_end[FRAME_PHASE_SWAP] - frame.start;
+        if (render_timer)
+        {
+            // GPU time is available once the frame has been rendered, read it on the next frame.
+            pending_cpu_time   = cpu_time;
+            pending_effect_set = get_effect_set();
+        } else
+        {
+            delay_manager->report_render_time(get_effect_set(), cpu_time);
+        }
     }
 
     const bool env_allow_scanout;
@@ -1011,8 +1929,9 @@ class wf::render_manager::impl
         params.reference_output = this->output;
         params.renderer = output->handle->renderer;
         params.flags    = RPASS_CLEAR_BACKGROUND | RPASS_EMIT_SIGNALS;
+        params.damage_coalesce_threshold = damage_coalesce_threshold;
 
-        pass_opts.timer = NULL; // TODO: do we care about this? could be useful for dynamic frame scheduling
+        pass_opts.timer = prepare_render_timer();
         pass_opts.color_transform = icc_color_transform;
         params.pass_opts   = &pass_opts;
         this->current_pass = std::make_unique<render_pass_t>(params);
@@ -1055,34 +1974,115 @@ class wf::render_manager::impl
         postprocessing->set_current_buffer(nullptr);
     }
 
+    /**
+     * Paint the output now, or after the other outputs which are ready to paint, depending on
+     * core/paint_order.
+     */
+    void request_paint()
+    {
+        if (paint_order.value() != "deadline")
+        {
+            paint();
+            return;
+        }
+
+        // Without a fixed refresh rate, assume 60Hz.
+        const int64_t refresh_mhz = output->handle->refresh > 0 ? output->handle->refresh : 60'000;
+        const int64_t next_vblank = last_frame_event + 1'000'000'000ll / refresh_mhz;
+        paint_order_queue_t::get().schedule(this, next_vblank - expected_paint_time, [=] () { paint(); });
+    }
+
     /**
      * Repaints the whole output, includes all effects and hooks
      */
     void paint()
+    {
+        TRACE_SCOPE(RENDER, paint_trace_name);
+        auto& frame = timeline->start_frame();
+        const int64_t stall_threshold = frame_stall_threshold * 1000ll;
+        if (stall_threshold > 0)
+        {
+            frame_profiler_t::get().begin_frame(stall_threshold);
+        }
+
+        frame.result = paint_frame(frame);
+        if ((frame.result == frame_result_t::RENDERED) || (frame.result == frame_result_t::SCANOUT))
+        {
+            frame.commit_seq = output->handle->commit_seq;
+        }
+
+        if (stall_threshold > 0)
+        {
+            auto report = frame_profiler_t::get().end_frame(FRAME_STALL_ENTRIES);
+            if (wf::get_current_time_us() - frame.start > stall_threshold)
+            {
+                report_frame_stall(frame, report);
+            }
+        }
+
+        if (frame.result == frame_result_t::RENDERED)
+        {
+            const int64_t paint_time = frame.phase_end[FRAME_PHASE_POST_PAINT] - frame.start;
+            budget->report_frame(paint_time);
+            expected_paint_time = expected_paint_time ? (7 * expected_paint_time + paint_time) / 8 : paint_time;
+        }
+
+        report_render_time(frame);
+    }
+
+    void report_frame_stall(const frame_timing_t& frame, const frame_stall_report_t& report)
+    {
+        LOGW("Frame ", frame.seq, " on output ", output->to_string(), " took ",
+            (wf::get_current_time_us() - frame.start) / 1000.0, "ms. Most expensive operations:");
+
+        auto log_entries = [] (const char *kind, const std::vector<frame_stall_entry_t>& entries)
+        {
+            for (auto& entry : entries)
+            {
+                LOGW("    ", kind, " ", entry.name, " (", entry.stage, "): ", entry.duration, "us");
+            }
+        };
+
+        log_entries("instance", report.instances);
+        log_entries("hook", report.hooks);
+        log_entries("pass", report.passes);
+
+        output_frame_stall_signal ev{output, frame, report};
+        output->emit(&ev);
+    }
+
+    frame_result_t paint_frame(frame_timing_t& frame)
     {
         /* Part 1: frame setup: query damage, etc. */
         effects->run_effects(OUTPUT_EFFECT_PRE);
+        timeline->mark(FRAME_PHASE_PRE_EFFECTS);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        timeline->mark(FRAME_PHASE_DAMAGE_EFFECTS);
 
-        if (do_direct_scanout())
+        const bool scanout = do_direct_scanout();
+        timeline->mark(FRAME_PHASE_SCANOUT);
+        if (scanout)
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
-            return;
+            return frame_result_t::SCANOUT;
         }
 
         auto next_frame = damage_manager->start_frame();
+        timeline->mark(FRAME_PHASE_START_FRAME);
         if (!next_frame)
         {
             // Optimization: the output doesn't need a new frame (so isn't damaged), so we can
             // just skip the whole repaint
             delay_manager->skip_frame();
-            return;
+            return frame_result_t::SKIPPED;
         }
 
         /* Part 2: call the renderer, which sets swap_damage and draws the scenegraph */
         update_bound_output(next_frame->buffer);
         this->swap_damage = start_output_pass(next_frame);
+        frame.culled_instructions = current_pass->get_culled_instructions();
+        timeline->mark(FRAME_PHASE_RENDER_PASS);
 
         /* Part 3: overlay effects */
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
@@ -1091,14 +2091,17 @@ class wf::render_manager::impl
             current_pass->clear(current_pass->get_target().geometry, {0, 0, 0, 1});
         }
 
+        timeline->mark(FRAME_PHASE_OVERLAY);
+
         /* Part 4: we are done with the main scene. Submit the main render pass. */
         const bool pass_status = current_pass->submit();
         current_pass.reset();
+        timeline->mark(FRAME_PHASE_SUBMIT);
         if (!pass_status)
         {
             LOGE("Failed to submit render pass!");
             wlr_buffer_unlock(next_frame->buffer);
-            return;
+            return frame_result_t::FAILED;
         }
 
         effects->run_effects(OUTPUT_EFFECT_PASS_DONE);
@@ -1106,24 +2109,40 @@ class wf::render_manager::impl
         /* Part 5: finalize the scene: postprocessing effects */
         if (postprocessing->post_effects.size())
         {
-            swap_damage |= damage_manager->get_buffer_extents();
+            // Effects report the parameters they used, so damage is transformed after running them.
+            // The untransformed damage is kept too, because it contains the damage of software cursors,
+            // which are drawn on top of the post effects.
+            // The cursor may also have been warped without an input event (e.g. by a plugin).
+            check_cursor_moved();
+            const auto extents = damage_manager->get_buffer_extents();
+            postprocessing->run_post_effects();
+            swap_damage = full_post_damage ? wf::region_t{extents} :
+                (postprocessing->transform_damage(swap_damage, extents) | swap_damage);
+            full_post_damage = false;
+            last_post_pointer = get_clamped_pointer();
         }
 
-        postprocessing->run_post_effects();
+        timeline->mark(FRAME_PHASE_POSTPROCESS);
 
         /* Part 6: render sw cursors We render software cursors after everything else
          * for consistency with hardware cursor planes */
-        render_sw_cursors(next_frame.get());
+        // Post effects repaint the whole buffer, even if the swap damage is smaller.
+        render_sw_cursors(next_frame.get(), postprocessing->post_effects.size() ?
+            wf::region_t{damage_manager->get_buffer_extents()} : swap_damage);
+        timeline->mark(FRAME_PHASE_SW_CURSORS);
 
         /* Part 7: finalize frame: swap buffers, send frame_done, etc */
-        damage_manager->swap_buffers(std::move(next_frame), swap_damage);
+        const bool swapped = damage_manager->swap_buffers(std::move(next_frame), swap_damage);
+        timeline->mark(FRAME_PHASE_SWAP);
 
         unset_bound_output();
         swap_damage.clear();
         post_paint();
+        timeline->mark(FRAME_PHASE_POST_PAINT);
+        return swapped ? frame_result_t::RENDERED : frame_result_t::FAILED;
     }
 
-    void render_sw_cursors(swapchain_damage_manager_t::frame_object_t *next_frame)
+    void render_sw_cursors(swapchain_damage_manager_t::frame_object_t *next_frame, wf::region_t damage)
     {
         auto sw_cursor_pass =
             wlr_renderer_begin_buffer_pass(output->handle->renderer, next_frame->buffer, nullptr);
@@ -1134,7 +2153,7 @@ class wf::render_manager::impl
         }
 
         wlr_output_add_software_cursors_to_render_pass(output->handle,
-            sw_cursor_pass, swap_damage.to_pixman());
+            sw_cursor_pass, damage.to_pixman());
         wlr_render_pass_submit(sw_cursor_pass);
     }
 
@@ -1148,7 +2167,89 @@ class wf::render_manager::impl
         {
             damage_manager->schedule_repaint();
         }
+
+        if (postprocessing->is_animating())
+        {
+            full_post_damage = true;
+            damage_manager->schedule_repaint();
+        }
+    }
+
+    /* Whether the post effects need to repaint the whole output on the next frame */
+    bool full_post_damage = false;
+    /* The pointer position when the post effects were last run */
+    wf::pointf_t last_post_pointer;
+
+    wf::pointf_t get_clamped_pointer()
+    {
+        auto cursor = output->get_cursor_position();
+        wf::pointf_t result;
+        wlr_box box = output->get_relative_geometry();
+        wlr_box_closest_point(&box, cursor.x, cursor.y, &result.x, &result.y);
+        return result;
+    }
+
+    /**
+     * Check whether the cursor moved since the post effects were last run, and
+     * if so, repaint the whole output if the effects depend on the pointer.
+     *
+     * @return Whether the cursor position changed.
+     */
+    bool check_cursor_moved()
+    {
+        if (!postprocessing->depends_on_pointer())
+        {
+            return false;
+        }
+
+        auto pointer = get_clamped_pointer();
+        if ((pointer.x != last_post_pointer.x) || (pointer.y != last_post_pointer.y))
+        {
+            full_post_damage = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    void handle_pointer_motion()
+    {
+        if (check_cursor_moved())
+        {
+            damage_manager->schedule_repaint();
+        }
     }
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_pointer_motion =
+        [=] (auto)
+    {
+        handle_pointer_motion();
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_absolute_event>>
+    on_pointer_motion_absolute = [=] (auto)
+    {
+        handle_pointer_motion();
+    };
+
+    // Tablet tools move the cursor too.
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_tip_event>> on_tablet_tip =
+        [=] (auto)
+    {
+        handle_pointer_motion();
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_axis_event>> on_tablet_axis =
+        [=] (auto)
+    {
+        handle_pointer_motion();
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_tablet_tool_proximity_event>>
+    on_tablet_proximity = [=] (auto)
+    {
+        handle_pointer_motion();
+    };
 };
 
 scene::direct_scanout scene::try_scanout_from_list(
@@ -1179,6 +2280,30 @@ void scene::compute_visibility_from_list(const std::vector<render_instance_uptr>
     region += offset;
 }
 
+std::string scene::render_instance_t::stringify() const
+{
+    // Type names are mangled, which makes them hard to read in stall reports and traces.
+    const char *mangled = typeid(*this).name();
+    int status;
+    char *demangled = abi::__cxa_demangle(mangled, NULL, NULL, &status);
+    std::string result = (status == 0) ? demangled : mangled;
+    free(demangled);
+    return result;
+}
+
+void scene::expand_damage_from_list(const std::vector<render_instance_uptr>& instances,
+    const wf::render_target_t& target, wf::region_t& damage, const wf::point_t& offset)
+{
+    auto our_target = target.translated(-offset);
+    damage -= offset;
+    for (auto& ch : instances)
+    {
+        ch->expand_damage(our_target, damage);
+    }
+
+    damage += offset;
+}
+
 render_manager::render_manager(output_t *o) :
     pimpl(new impl(o))
 {}
@@ -1204,9 +2329,9 @@ void render_manager::add_inhibit(bool add)
     pimpl->add_inhibit(add);
 }
 
-void render_manager::add_effect(effect_hook_t *hook, output_effect_type_t type)
+void render_manager::add_effect(effect_hook_t *hook, output_effect_type_t type, std::string name)
 {
-    pimpl->effects->add_effect(hook, type);
+    pimpl->effects->add_effect(hook, type, std::move(name));
 }
 
 void render_manager::rem_effect(effect_hook_t *hook)
@@ -1214,9 +2339,9 @@ void render_manager::rem_effect(effect_hook_t *hook)
     pimpl->effects->rem_effect(hook);
 }
 
-void render_manager::add_post(post_hook_t *hook)
+void render_manager::add_post(post_hook_t *hook, post_effect_dependencies_t dependencies, std::string name)
 {
-    pimpl->postprocessing->add_post(hook);
+    pimpl->postprocessing->add_post(hook, std::move(dependencies), std::move(name));
 }
 
 void render_manager::rem_post(post_hook_t *hook)
@@ -1224,6 +2349,17 @@ void render_manager::rem_post(post_hook_t *hook)
     pimpl->postprocessing->rem_post(hook);
 }
 
+void render_manager::add_post(fusible_post_effect_t *effect, post_effect_dependencies_t dependencies,
+    std::string name)
+{
+    pimpl->postprocessing->add_post(effect, std::move(dependencies), std::move(name));
+}
+
+void render_manager::rem_post(fusible_post_effect_t *effect)
+{
+    pimpl->postprocessing->rem_post(effect);
+}
+
 wf::region_t render_manager::get_scheduled_damage()
 {
     return pimpl->damage_manager->get_scheduled_damage(get_target_framebuffer());
@@ -1271,6 +2407,34 @@ void render_manager::set_require_depth_buffer(bool require)
     return pimpl->depth_buffer_manager->set_required(require);
 }
 
+void render_manager::add_quality_callback(quality_callback_t *callback)
+{
+    pimpl->budget->add_callback(callback);
+}
+
+void render_manager::rem_quality_callback(quality_callback_t *callback)
+{
+    pimpl->budget->rem_callback(callback);
+}
+
+int render_manager::get_quality_reduction() const
+{
+    return pimpl->budget->reduction;
+}
+
+std::vector<hook_timing_t> render_manager::get_hook_timings() const
+{
+    std::vector<hook_timing_t> result;
+    pimpl->effects->timings.append_to(result);
+    pimpl->postprocessing->timings.append_to(result);
+    return result;
+}
+
+std::vector<frame_timing_t> render_manager::get_frame_timeline() const
+{
+    return pimpl->timeline->get_frames();
+}
+
 wf::render_pass_t*render_manager::get_current_pass()
 {
     return pimpl->current_pass.get();
@@ -1285,6 +2449,11 @@ void priv_render_manager_start_rendering(wf::render_manager *manager)
 {
     manager->pimpl->damage_manager->start_rendering();
 }
+
+void priv_render_manager_report_instance_regen(wf::render_manager *manager, int nodes, int64_t duration)
+{
+    manager->pimpl->timeline->report_instance_regen(nodes, duration);
+}
 } // namespace wf
 
 /* End render_manager */
@@ -7,6 +7,9 @@
 #include <wayfire/render-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <set>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/util/log.hpp>
@@ -109,30 +112,6 @@ struct grid_size_manager_t
     }
 };
 
-static wf::scene::node_t *find_lca(wf::scene::node_t *a, wf::scene::node_t *b)
-{
-    wf::scene::node_t *iter = a;
-    std::set<wf::scene::node_t*> a_ancestors;
-    while (iter)
-    {
-        a_ancestors.insert(iter);
-        iter = iter->parent();
-    }
-
-    iter = b;
-    while (iter)
-    {
-        if (a_ancestors.count(iter))
-        {
-            return iter;
-        }
-
-        iter = iter->parent();
-    }
-
-    return nullptr;
-}
-
 static bool is_attached_to(wf::scene::node_t *a, wf::scene::node_t *root)
 {
     while (a)
@@ -148,23 +127,6 @@ static bool is_attached_to(wf::scene::node_t *a, wf::scene::node_t *root)
     return false;
 }
 
-static bool is_attached_to_scenegraph(wf::scene::node_t *a)
-{
-    return is_attached_to(a, wf::get_core().scene().get());
-}
-
-static size_t find_index_in_parent(wf::scene::node_t *x, wf::scene::node_t *parent)
-{
-    while (x->parent() != parent)
-    {
-        x = x->parent();
-    }
-
-    auto& children = parent->get_children();
-    auto it = std::find_if(children.begin(), children.end(), [&] (auto child) { return child.get() == x; });
-    return it - children.begin();
-}
-
 class workspace_set_root_node_t : public wf::scene::floating_inner_node_t
 {
     uint64_t index;
@@ -214,6 +176,7 @@ struct workspace_set_t::impl
         if (!workspace_geometry)
         {
             workspace_geometry = new_geometry;
+            invalidate_view_index();
             return;
         }
 
@@ -247,11 +210,13 @@ struct workspace_set_t::impl
         }
 
         workspace_geometry = new_geometry;
+        invalidate_view_index();
     }
 
     wf::signal::connection_t<workspace_grid_changed_signal> on_grid_changed =
         [=] (workspace_grid_changed_signal *ev)
     {
+        invalidate_view_index();
         if (!workspace_geometry)
         {
             return;
@@ -282,6 +247,40 @@ struct workspace_set_t::impl
         remove_view(toplevel_cast(ev->object));
     };
 
+    wf::signal::connection_t<view_geometry_changed_signal> on_view_geometry_changed =
+        [=] (view_geometry_changed_signal *ev)
+    {
+        mark_view_dirty(ev->view);
+    };
+
+    wf::signal::connection_t<view_set_sticky_signal> on_view_sticky_changed =
+        [=] (view_set_sticky_signal *ev)
+    {
+        mark_view_dirty(ev->view);
+    };
+
+    // Views may be restacked anywhere in the scenegraph, for example in the layers of the output, in nested
+    // containers or in the core's own layers (always-on-top views). The root update signal reports all of
+    // them, since it carries the children list changes of the whole update sequence.
+    wf::signal::connection_t<scene::root_node_update_signal> on_root_update =
+        [=] (scene::root_node_update_signal *ev)
+    {
+        if (ev->flags & scene::update_flag::CHILDREN_LIST)
+        {
+            ++stacking_serial;
+        }
+    };
+
+    // Workspace sets which are not attached to an output are not part of the scenegraph, so their updates
+    // do not reach the root.
+    wf::signal::connection_t<scene::node_update_signal> on_wnode_update = [=] (scene::node_update_signal *ev)
+    {
+        if (ev->flags & scene::update_flag::CHILDREN_LIST)
+        {
+            ++stacking_serial;
+        }
+    };
+
     bool visible = false;
 
   public:
@@ -299,6 +298,8 @@ struct workspace_set_t::impl
         wnode = std::make_shared<workspace_set_root_node_t>(index);
         wnode->set_enabled(false);
         self->connect(&on_grid_changed);
+        wnode->connect(&on_wnode_update);
+        wf::get_core().scene()->connect(&on_root_update);
         wf::get_core().output_layout->connect(&on_output_removed);
     }
 
@@ -391,6 +392,11 @@ struct workspace_set_t::impl
         LOGC(WSET, "Adding view ", view, " to wset ", index);
         wset_views.push_back(view);
         view->connect(&on_view_destruct);
+        view->connect(&on_view_geometry_changed);
+        view->connect(&on_view_sticky_changed);
+        view_index[view.get()].order = next_view_order++;
+        mark_view_dirty(view);
+        ++stacking_serial;
         view->priv->current_wset = self->weak_from_this();
         view->set_output(this->output);
     }
@@ -407,6 +413,11 @@ struct workspace_set_t::impl
         LOGC(WSET, "Removing view ", view, " from id=", index);
         wset_views.erase(it);
         view->disconnect(&on_view_destruct);
+        view->disconnect(&on_view_geometry_changed);
+        view->disconnect(&on_view_sticky_changed);
+        remove_from_view_index(view);
+        view_index.erase(view.get());
+        dirty_views.erase(view.get());
         view->priv->current_wset.reset();
     }
 
@@ -423,55 +434,219 @@ struct workspace_set_t::impl
             workspace = get_current_workspace();
         }
 
-        auto views = wset_views;
-        auto it    = std::remove_if(views.begin(), views.end(), [&] (wayfire_toplevel_view view)
+        // Start from the views on the workspace if it is in the index, so that the cost depends only on the
+        // number of views there.
+        const bool indexed = workspace && grid.is_workspace_valid(*workspace);
+        const auto& candidates = indexed ? get_views_on_workspace(*workspace) : wset_views;
+        if (flags & WSET_SORT_STACKING)
+        {
+            update_stacking_ranks();
+        }
+
+        std::vector<wayfire_toplevel_view> views;
+        views.reserve(candidates.size());
+        for (auto& view : candidates)
         {
             if ((flags & WSET_MAPPED_ONLY) && !view->is_mapped())
             {
-                return true;
+                continue;
             }
 
             if ((flags & WSET_EXCLUDE_MINIMIZED) && view->minimized)
             {
-                return true;
+                continue;
             }
 
-            if ((flags & WSET_SORT_STACKING) && !is_attached_to_scenegraph(view->get_root_node().get()))
+            if ((flags & WSET_SORT_STACKING) && !stacking_rank.count(view->get_root_node().get()))
             {
-                return true;
+                // Not attached to the scenegraph
+                continue;
             }
 
-            if (workspace && !view_visible_on(view, *workspace))
+            if (workspace && !indexed && !view_visible_on(view, *workspace))
             {
-                return true;
+                continue;
             }
 
-            return false;
-        });
-        views.erase(it, views.end());
+            views.push_back(view);
+        }
 
         if (flags & WSET_SORT_STACKING)
         {
-            std::sort(views.begin(), views.end(), [] (wayfire_toplevel_view a, wayfire_view b)
+            std::sort(views.begin(), views.end(), [&] (wayfire_toplevel_view a, wayfire_toplevel_view b)
             {
-                wf::scene::node_t *x   = a->get_root_node().get();
-                wf::scene::node_t *y   = b->get_root_node().get();
-                wf::scene::node_t *lca = find_lca(x, y);
-                wf::dassert(lca != nullptr,
-                    "LCA should always exist when the two nodes are in the scenegraph!");
-                wf::dassert((lca != x) && (lca != y), "LCA should not be equal to one of the nodes, this"
-                                                      "means nested views/dialogs have been added to the wset!");
-
-                const size_t idx_x = find_index_in_parent(x, lca);
-                const size_t idx_y = find_index_in_parent(y, lca);
-                return idx_x < idx_y;
+                return stacking_rank[a->get_root_node().get()] < stacking_rank[b->get_root_node().get()];
             });
         }
 
         return views;
     }
 
+    const std::vector<wayfire_toplevel_view>& get_views_on_workspace(wf::point_t workspace)
+    {
+        static const std::vector<wayfire_toplevel_view> none;
+        if (!grid.is_workspace_valid(workspace))
+        {
+            return none;
+        }
+
+        flush_view_index();
+        auto it = workspace_views.find({workspace.x, workspace.y});
+        return (it == workspace_views.end()) ? none : it->second;
+    }
+
   private:
+    struct view_index_entry_t
+    {
+        // The position of the view in wset_views, the per-workspace lists are kept in the same order.
+        uint64_t order = 0;
+        // The workspaces the view was visible on when the entry was last updated.
+        std::vector<wf::point_t> workspaces;
+    };
+
+    // An index from workspaces to the views visible on them. It is updated lazily: changes to single views
+    // only mark them as dirty, and changes which affect all views (switching workspaces, changing the grid
+    // or the output geometry) invalidate the whole index. Both are resolved on the next query.
+    std::unordered_map<toplevel_view_interface_t*, view_index_entry_t> view_index;
+    std::map<std::pair<int, int>, std::vector<wayfire_toplevel_view>> workspace_views;
+    std::unordered_set<toplevel_view_interface_t*> dirty_views;
+    bool view_index_valid    = false;
+    uint64_t next_view_order = 0;
+
+    // The position of the root node of each view attached to the scenegraph, in stacking order (top first).
+    // Recomputed when the stacking serial changes, which happens whenever views may have been restacked.
+    std::unordered_map<wf::scene::node_t*, size_t> stacking_rank;
+    uint64_t stacking_serial = 0;
+    std::optional<uint64_t> stacking_rank_serial;
+
+    void invalidate_view_index()
+    {
+        view_index_valid = false;
+        dirty_views.clear();
+    }
+
+    void mark_view_dirty(wayfire_toplevel_view view)
+    {
+        if (view_index_valid)
+        {
+            dirty_views.insert(view.get());
+        }
+    }
+
+    std::vector<wf::point_t> compute_visible_workspaces(wayfire_toplevel_view view)
+    {
+        std::vector<wf::point_t> workspaces;
+        if (!workspace_geometry)
+        {
+            return workspaces;
+        }
+
+        for (int i = 0; i < grid.grid.width; i++)
+        {
+            for (int j = 0; j < grid.grid.height; j++)
+            {
+                if (view_visible_on(view, {i, j}))
+                {
+                    workspaces.push_back({i, j});
+                }
+            }
+        }
+
+        return workspaces;
+    }
+
+    void remove_from_view_index(wayfire_toplevel_view view)
+    {
+        for (auto& ws : view_index[view.get()].workspaces)
+        {
+            auto& list = workspace_views[{ws.x, ws.y}];
+            list.erase(std::remove(list.begin(), list.end(), view), list.end());
+        }
+
+        view_index[view.get()].workspaces.clear();
+    }
+
+    void add_to_view_index(wayfire_toplevel_view view)
+    {
+        auto& entry = view_index[view.get()];
+        entry.workspaces = compute_visible_workspaces(view);
+        for (auto& ws : entry.workspaces)
+        {
+            auto& list = workspace_views[{ws.x, ws.y}];
+            auto pos   = std::upper_bound(list.begin(), list.end(), entry.order,
+                [&] (uint64_t order, const wayfire_toplevel_view& other)
+            {
+                return order < view_index[other.get()].order;
+            });
+            list.insert(pos, view);
+        }
+    }
+
+    void flush_view_index()
+    {
+        if (!view_index_valid)
+        {
+            workspace_views.clear();
+            for (auto& view : wset_views)
+            {
+                auto& entry = view_index[view.get()];
+                entry.workspaces = compute_visible_workspaces(view);
+                for (auto& ws : entry.workspaces)
+                {
+                    workspace_views[{ws.x, ws.y}].push_back(view);
+                }
+            }
+
+            view_index_valid = true;
+            dirty_views.clear();
+            return;
+        }
+
+        for (auto& view : wset_views)
+        {
+            if (dirty_views.count(view.get()))
+            {
+                remove_from_view_index(view);
+                add_to_view_index(view);
+            }
+        }
+
+        dirty_views.clear();
+    }
+
+    void update_stacking_ranks()
+    {
+        if (stacking_rank_serial == stacking_serial)
+        {
+            return;
+        }
+
+        stacking_rank.clear();
+        stacking_rank_serial = stacking_serial;
+
+        std::unordered_set<wf::scene::node_t*> view_nodes;
+        for (auto& view : wset_views)
+        {
+            view_nodes.insert(view->get_root_node().get());
+        }
+
+        // Children are sorted from top to bottom, so a pre-order traversal visits the views in stacking order.
+        size_t next_rank = 0;
+        std::function<void(wf::scene::node_t*)> visit = [&] (wf::scene::node_t *node)
+        {
+            if (view_nodes.count(node))
+            {
+                stacking_rank[node] = next_rank++;
+            }
+
+            for (auto& child : node->get_children())
+            {
+                visit(child.get());
+            }
+        };
+        visit(wf::get_core().scene().get());
+    }
+
     std::vector<wayfire_toplevel_view> wset_views;
 
     int current_vx = 0;
@@ -595,6 +770,7 @@ struct workspace_set_t::impl
          * views. */
         current_vx = nws.x;
         current_vy = nws.y;
+        invalidate_view_index();
 
         auto screen = wf::dimensions(*workspace_geometry);
         auto dx     = (data.old_viewport.x - nws.x) * screen.width;
@@ -696,6 +872,11 @@ std::vector<wayfire_toplevel_view> workspace_set_t::get_views(uint32_t flags, st
     return pimpl->get_views(flags, ws);
 }
 
+const std::vector<wayfire_toplevel_view>& workspace_set_t::get_views_on_workspace(wf::point_t ws)
+{
+    return pimpl->get_views_on_workspace(ws);
+}
+
 void workspace_set_t::remove_view(wayfire_toplevel_view view)
 {
     pimpl->remove_view(view);
@@ -9,17 +9,105 @@
 #include <wayfire/output.hpp>
 #include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-set.hpp>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
 
 namespace wf
 {
+static bool is_layer_shown(wf::output_t *output, const std::shared_ptr<scene::output_node_t>& node,
+    layer_mask_t layers)
+{
+    if (layers == ALL_LAYERS_MASK)
+    {
+        return true;
+    }
+
+    for (size_t layer = 0; layer < (size_t)scene::layer::ALL_LAYERS; layer++)
+    {
+        if (output->node_for_layer((scene::layer)layer) == node)
+        {
+            return layers & layer_to_mask((scene::layer)layer);
+        }
+    }
+
+    return false;
+}
+
 class workspace_stream_node_t::workspace_stream_instance_t : public scene::
     render_instance_t
 {
     workspace_stream_node_t *self;
 
-    std::vector<scene::render_instance_uptr> instances;
-    // True for each instance generated from a desktop environment view.
-    std::vector<bool> is_desktop_environment;
+    struct child_t
+    {
+        scene::node_ptr node;
+        // Desktop environment views are visible on every workspace, at their position on the current workspace.
+        bool is_desktop_environment = false;
+        // Views are shown only while they intersect the workspace, other nodes are always shown.
+        bool is_view = false;
+        // The bounding box of the node when it was last checked.
+        wf::geometry_t bbox;
+        std::vector<scene::render_instance_uptr> instances;
+    };
+
+    // The nodes which may be visible on the workspace, from top to bottom.
+    std::vector<child_t> children;
+    // The workspace set node whose children are listed individually.
+    scene::node_ptr wset_node;
+
+    scene::damage_callback push_damage;
+    scene::damage_callback translate_and_push_damage;
+
+    // Changes in the subtree of a child only affect its own instances, views moving into or out of the
+    // workspace get or lose their render instances.
+    wf::signal::connection_t<scene::node_update_signal> on_child_update = [=] (scene::node_update_signal *ev)
+    {
+        if ((ev->flags & scene::update_flag::MASKED) && ev->node->is_enabled())
+        {
+            // A disabled node in the child's subtree changed, nothing to do.
+            return;
+        }
+
+        auto it = std::find_if(children.begin(), children.end(), [&] (const child_t& child)
+        {
+            return child.node.get() == ev->node;
+        });
+        if (it == children.end())
+        {
+            return;
+        }
+
+        if (ev->flags & (scene::update_flag::CHILDREN_LIST | scene::update_flag::ENABLED))
+        {
+            regen_child(*it);
+        } else if (it->is_view && (ev->flags & scene::update_flag::GEOMETRY))
+        {
+            update_view_child(*it);
+        }
+    };
+
+    // Nodes are added to or removed from the output's layers or the workspace set.
+    wf::signal::connection_t<scene::node_update_signal> on_container_update =
+        [=] (scene::node_update_signal *ev)
+    {
+        if ((ev->flags & scene::update_flag::MASKED) && ev->node->is_enabled())
+        {
+            return;
+        }
+
+        if (ev->flags & (scene::update_flag::CHILDREN_LIST | scene::update_flag::ENABLED))
+        {
+            sync_children();
+        }
+    };
+
+    // The workspace set node is skipped in favor of its children, so forward its own damage.
+    wf::signal::connection_t<scene::node_damage_signal> on_wset_damage = [=] (scene::node_damage_signal *ev)
+    {
+        translate_and_push_damage(ev->region);
+    };
 
     wf::point_t get_offset()
     {
@@ -31,45 +119,187 @@ class workspace_stream_node_t::workspace_stream_instance_t : public scene::
         };
     }
 
-  public:
-    workspace_stream_instance_t(workspace_stream_node_t *self,
-        scene::damage_callback push_damage)
+    // The workspace in the coordinate system of the output, where the current workspace is at (0, 0).
+    wf::geometry_t get_workspace_box()
     {
-        this->self = self;
-        auto translate_and_push_damage = [this, push_damage] (wf::region_t damage)
+        return self->get_bounding_box() + get_offset();
+    }
+
+    void push_child_damage(const child_t& child, const wf::region_t& region)
+    {
+        // We push the damage as-is for desktop environment views, because they are visible on every
+        // workspace.
+        if (child.is_desktop_environment)
         {
-            damage += -get_offset();
-            push_damage(damage);
+            push_damage(region);
+        } else
+        {
+            translate_and_push_damage(region);
+        }
+    }
+
+    bool should_show(const child_t& child)
+    {
+        return child.node->is_enabled() && (!child.is_view || (child.bbox & get_workspace_box()));
+    }
+
+    void gen_child_instances(child_t& child)
+    {
+        child.bbox = child.node->get_bounding_box();
+        if (should_show(child))
+        {
+            child.node->gen_render_instances(child.instances,
+                child.is_desktop_environment ? push_damage : translate_and_push_damage, self->output);
+        }
+    }
+
+    void regen_child(child_t& child)
+    {
+        const auto old_bbox = child.bbox;
+        child.instances.clear();
+        gen_child_instances(child);
+        push_child_damage(child, wf::region_t{old_bbox} | child.bbox);
+    }
+
+    void update_view_child(child_t& child)
+    {
+        const bool was_shown = !child.instances.empty();
+        child.bbox = child.node->get_bounding_box();
+        const bool shown = should_show(child);
+        if (shown == was_shown)
+        {
+            return;
+        }
+
+        if (shown)
+        {
+            child.node->gen_render_instances(child.instances, translate_and_push_damage, self->output);
+        } else
+        {
+            child.instances.clear();
+        }
+
+        // The view appeared on or left the workspace.
+        translate_and_push_damage(child.bbox);
+    }
+
+    child_t make_child(const scene::node_ptr& node)
+    {
+        child_t child;
+        child.node = node;
+        auto view = node_to_view(node);
+        child.is_desktop_environment = (view && (view->role == wf::VIEW_ROLE_DESKTOP_ENVIRONMENT));
+        child.is_view = view && !child.is_desktop_environment;
+        gen_child_instances(child);
+        node->connect(&on_child_update);
+        return child;
+    }
+
+    /**
+     * Bring the list of children up to date with the children of the output's layers and of the workspace
+     * set. Children which are still present keep their instances.
+     *
+     * @param damage Whether to damage the nodes which were added or removed.
+     */
+    void sync_children(bool damage = true)
+    {
+        auto new_wset_node = self->output->wset()->get_node();
+        if (new_wset_node != wset_node)
+        {
+            if (wset_node)
+            {
+                wset_node->disconnect(&on_wset_damage);
+                wset_node->disconnect(&on_container_update);
+            }
+
+            wset_node = new_wset_node;
+            wset_node->connect(&on_wset_damage);
+            wset_node->connect(&on_container_update);
+        }
+
+        std::unordered_map<scene::node_t*, child_t> old_children;
+        for (auto& child : children)
+        {
+            auto node = child.node.get();
+            old_children.emplace(node, std::move(child));
+        }
+
+        children.clear();
+        auto add_child = [&] (const scene::node_ptr& node)
+        {
+            auto it = old_children.find(node.get());
+            if (it != old_children.end())
+            {
+                children.push_back(std::move(it->second));
+                old_children.erase(it);
+            } else
+            {
+                children.push_back(make_child(node));
+                if (damage)
+                {
+                    push_child_damage(children.back(), children.back().bbox);
+                }
+            }
         };
 
         for (auto& output_node : wf::collect_output_nodes(wf::get_core().scene(), self->output))
         {
+            if (!output_node->is_enabled() || !is_layer_shown(self->output, output_node, self->layers))
+            {
+                continue;
+            }
+
             for (auto& ch : output_node->get_children())
             {
-                if (ch->is_enabled())
+                if (ch == wset_node)
                 {
-                    auto view = node_to_view(ch);
-                    const bool is_de     = (view && (view->role == wf::VIEW_ROLE_DESKTOP_ENVIRONMENT));
-                    size_t num_generated = this->instances.size();
-
-                    // We push the damage as-is for desktop environment views, because they are visible on
-                    // every workspace.
-                    ch->gen_render_instances(this->instances,
-                        is_de ? push_damage : translate_and_push_damage, self->output);
-
-                    // Mark whether the instances were generated from a desktop environment view
-                    num_generated = this->instances.size() - num_generated;
-                    for (size_t i = 0; i < num_generated; i++)
+                    // Look at the views of the workspace set one by one, most of them are usually on other
+                    // workspaces.
+                    if (ch->is_enabled())
                     {
-                        is_desktop_environment.push_back(is_de);
+                        for (auto& view_node : ch->get_children())
+                        {
+                            add_child(view_node);
+                        }
                     }
+                } else
+                {
+                    add_child(ch);
                 }
             }
+        }
 
-            wf::dassert(instances.size() == is_desktop_environment.size(), "Setting de flag is wrong!");
+        // Drop the nodes which are gone, so that they are not kept alive by the stream.
+        for (auto& [node, child] : old_children)
+        {
+            node->disconnect(&on_child_update);
+            push_child_damage(child, child.bbox);
         }
     }
 
+  public:
+    workspace_stream_instance_t(workspace_stream_node_t *self,
+        scene::damage_callback push_damage)
+    {
+        this->self = self;
+        this->push_damage = push_damage;
+        this->translate_and_push_damage = [this, push_damage] (wf::region_t damage)
+        {
+            damage += -get_offset();
+            push_damage(damage);
+        };
+
+        for (auto& output_node : wf::collect_output_nodes(wf::get_core().scene(), self->output))
+        {
+            if (is_layer_shown(self->output, output_node, self->layers))
+            {
+                output_node->connect(&on_container_update);
+            }
+        }
+
+        sync_children(false);
+    }
+
     void schedule_instructions(
         std::vector<scene::render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
@@ -82,18 +312,21 @@ class workspace_stream_node_t::workspace_stream_instance_t : public scene::
             wf::render_target_t subtarget = target.translated(offset);
 
             our_damage += offset;
-            for (size_t i = 0; i < instances.size(); i++)
+            for (auto& child : children)
             {
-                if (is_desktop_environment[i])
+                for (auto& instance : child.instances)
                 {
-                    // Special handling: move everything to 'current workspace' so that panels and backgrounds
-                    // render at the correct position.
-                    our_damage -= offset;
-                    instances[i]->schedule_instructions(instructions, target, our_damage);
-                    our_damage += offset;
-                } else
-                {
-                    instances[i]->schedule_instructions(instructions, subtarget, our_damage);
+                    if (child.is_desktop_environment)
+                    {
+                        // Special handling: move everything to 'current workspace' so that panels and
+                        // backgrounds render at the correct position.
+                        our_damage -= offset;
+                        instance->schedule_instructions(instructions, target, our_damage);
+                        our_damage += offset;
+                    } else
+                    {
+                        instance->schedule_instructions(instructions, subtarget, our_damage);
+                    }
                 }
             }
 
@@ -110,6 +343,18 @@ class workspace_stream_node_t::workspace_stream_instance_t : public scene::
         }
     }
 
+    void expand_damage(const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        const auto offset = get_offset();
+        for (auto& child : children)
+        {
+            // Desktop environment views are at their position on the current workspace, like in
+            // schedule_instructions().
+            scene::expand_damage_from_list(child.instances, target, damage,
+                child.is_desktop_environment ? wf::point_t{0, 0} : -offset);
+        }
+    }
+
     void render(const wf::scene::render_instruction_t& data) override
     {
         static wf::option_wrapper_t<wf::color_t> background_color_opt{
@@ -122,15 +367,21 @@ class workspace_stream_node_t::workspace_stream_instance_t : public scene::
 
     void presentation_feedback(wf::output_t *output) override
     {
-        for (auto& ch : this->instances)
+        for (auto& child : children)
         {
-            ch->presentation_feedback(output);
+            for (auto& instance : child.instances)
+            {
+                instance->presentation_feedback(output);
+            }
         }
     }
 
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
-        scene::compute_visibility_from_list(instances, output, visible, -get_offset());
+        for (auto& child : children)
+        {
+            scene::compute_visibility_from_list(child.instances, output, visible, -get_offset());
+        }
     }
 };
 
@@ -157,4 +408,153 @@ std::string workspace_stream_node_t::stringify() const
     return "workspace-stream of output " + output->to_string() +
            " workspace " + std::to_string(ws.x) + "," + std::to_string(ws.y);
 }
+
+using workspace_texture_key_t = std::tuple<wf::output_t*, int, int, layer_mask_t, float>;
+
+static std::map<workspace_texture_key_t, std::weak_ptr<workspace_texture_t>>& get_workspace_textures()
+{
+    // Never freed, textures may be destroyed by plugins during shutdown.
+    static auto textures = new std::map<workspace_texture_key_t, std::weak_ptr<workspace_texture_t>>();
+    return *textures;
+}
+
+struct workspace_texture_t::impl
+{
+    std::shared_ptr<workspace_stream_node_t> stream;
+    std::vector<scene::render_instance_uptr> instances;
+    float scale;
+
+    wf::auxilliary_buffer_t buffer;
+    wf::region_t damage;
+
+};
+
+std::shared_ptr<workspace_texture_t> workspace_texture_t::get(wf::output_t *output, wf::point_t workspace,
+    layer_mask_t layers, float scale)
+{
+    auto& textures = get_workspace_textures();
+    const workspace_texture_key_t key{output, workspace.x, workspace.y, layers, scale};
+    if (auto existing = textures[key].lock())
+    {
+        return existing;
+    }
+
+    std::shared_ptr<workspace_texture_t> texture{new workspace_texture_t(output, workspace, layers, scale)};
+    textures[key] = texture;
+    return texture;
+}
+
+workspace_texture_t::workspace_texture_t(wf::output_t *output, wf::point_t workspace, layer_mask_t layers,
+    float scale)
+{
+    priv = std::make_unique<impl>();
+    priv->stream = std::make_shared<workspace_stream_node_t>(output, workspace);
+    priv->stream->layers = layers;
+    priv->scale = scale;
+    priv->buffer.set_owner("workspace texture: " + output->to_string());
+    priv->damage |= priv->stream->get_bounding_box();
+
+    auto push_damage = [this] (const wf::region_t& region)
+    {
+        priv->damage |= region;
+        workspace_texture_damage_signal ev;
+        ev.texture = this;
+        ev.region  = region;
+        this->emit(&ev);
+    };
+
+    // The instances of the stream follow the changes of the output's nodes on their own.
+    priv->stream->gen_render_instances(priv->instances, push_damage, output);
+}
+
+workspace_texture_t::~workspace_texture_t()
+{
+    get_workspace_textures().erase({get_output(), get_workspace().x, get_workspace().y, get_layers(),
+        get_scale()});
+}
+
+void workspace_texture_t::update(const wf::region_t& region)
+{
+    auto bbox = priv->stream->get_bounding_box();
+    wf::region_t to_render = priv->damage & region;
+    if (to_render.empty())
+    {
+        return;
+    }
+
+    auto result = priv->buffer.allocate(wf::dimensions(bbox), priv->scale, wf::buffer_allocation_hints_t{
+            .needs_alpha = false,
+        });
+    if (result == buffer_reallocation_result_t::REALLOCATED)
+    {
+        // The old contents are gone, including the parts which are not rendered now.
+        priv->damage |= bbox;
+        to_render = priv->damage & region;
+    }
+
+    wf::render_target_t target{priv->buffer};
+    target.geometry = bbox;
+    target.scale    = priv->scale;
+
+    render_pass_params_t params;
+    params.instances = &priv->instances;
+    params.damage    = to_render;
+    params.reference_output = priv->stream->output;
+    params.target = target;
+    params.flags  = RPASS_EMIT_SIGNALS;
+    wf::render_pass_t::run(params);
+
+    priv->damage ^= to_render;
+}
+
+void workspace_texture_t::update()
+{
+    update(priv->stream->get_bounding_box());
+}
+
+wf::texture_t workspace_texture_t::get_texture()
+{
+    return wf::texture_t{priv->buffer.get_texture()};
+}
+
+const wf::region_t& workspace_texture_t::get_pending_damage() const
+{
+    return priv->damage;
+}
+
+void workspace_texture_t::compute_visibility(wf::region_t& visible)
+{
+    for (auto& instance : priv->instances)
+    {
+        instance->compute_visibility(priv->stream->output, visible);
+    }
+}
+
+void workspace_texture_t::presentation_feedback()
+{
+    for (auto& instance : priv->instances)
+    {
+        instance->presentation_feedback(priv->stream->output);
+    }
+}
+
+wf::output_t*workspace_texture_t::get_output() const
+{
+    return priv->stream->output;
+}
+
+wf::point_t workspace_texture_t::get_workspace() const
+{
+    return priv->stream->ws;
+}
+
+layer_mask_t workspace_texture_t::get_layers() const
+{
+    return priv->stream->layers;
+}
+
+float workspace_texture_t::get_scale() const
+{
+    return priv->scale;
+}
 } // namespace wf
@@ -1,5 +1,6 @@
 #include <wayfire/region.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
+#include <vector>
 
 /* Pixman helpers */
 wlr_box wlr_box_from_pixman_box(const pixman_box32_t& box)
@@ -35,6 +36,19 @@ wf::region_t::region_t(const wlr_box& box)
     pixman_region32_init_rect(&_region, box.x, box.y, box.width, box.height);
 }
 
+wf::region_t::region_t(const pixman_box32_t *boxes, int count)
+{
+    if (count == 1)
+    {
+        // pixman stores single-box regions inline, avoid the validation of init_rects
+        const auto& box = boxes[0];
+        pixman_region32_init_rect(&_region, box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        return;
+    }
+
+    pixman_region32_init_rects(&_region, boxes, count);
+}
+
 wf::region_t::~region_t()
 {
     pixman_region32_fini(&_region);
@@ -95,6 +109,27 @@ void wf::region_t::expand_edges(int amount)
         return;
     }
 
+    if (!pixman_region32_not_empty(region))
+    {
+        return;
+    }
+
+    if (!region->data)
+    {
+        // Single box, we can expand it in place without allocating.
+        auto box = region->extents;
+        if ((box.x2 - box.x1 + 2 * amount <= 0) || (box.y2 - box.y1 + 2 * amount <= 0))
+        {
+            pixman_region32_clear(region);
+            return;
+        }
+
+        pixman_region32_fini(region);
+        pixman_region32_init_rect(region, box.x1 - amount, box.y1 - amount,
+            box.x2 - box.x1 + 2 * amount, box.y2 - box.y1 + 2 * amount);
+        return;
+    }
+
     int nrects;
     const pixman_box32_t *src_rects = pixman_region32_rectangles(region, &nrects);
 
@@ -123,6 +158,101 @@ void wf::region_t::expand_edges(int amount)
     free(dst_rects);
 }
 
+static int64_t box_area(const pixman_box32_t& box)
+{
+    return int64_t(box.x2 - box.x1) * int64_t(box.y2 - box.y1);
+}
+
+static pixman_box32_t box_union(const pixman_box32_t& a, const pixman_box32_t& b)
+{
+    return {
+        std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+        std::max(a.x2, b.x2), std::max(a.y2, b.y2),
+    };
+}
+
+void wf::region_t::coalesce(double max_overdraw)
+{
+    int nrects;
+    const pixman_box32_t *rects = pixman_region32_rectangles(&_region, &nrects);
+    if (nrects <= 1)
+    {
+        return;
+    }
+
+    const double max_ratio = 1.0 + std::max(0.0, max_overdraw);
+
+    // Fast path: the whole region is dense enough to be replaced by its extents.
+    int64_t covered = 0;
+    for (int i = 0; i < nrects; i++)
+    {
+        covered += box_area(rects[i]);
+    }
+
+    const pixman_box32_t extents = get_extents();
+    if (box_area(extents) <= max_ratio * covered)
+    {
+        pixman_region32_fini(&_region);
+        pixman_region32_init_rect(&_region, extents.x1, extents.y1,
+            extents.x2 - extents.x1, extents.y2 - extents.y1);
+        return;
+    }
+
+    // Otherwise, greedily grow clusters of nearby rectangles.
+    struct cluster_t
+    {
+        pixman_box32_t box;
+        int64_t covered;
+    };
+
+    std::vector<cluster_t> clusters;
+    for (int i = 0; i < nrects; i++)
+    {
+        cluster_t current{rects[i], box_area(rects[i])};
+
+        // Merging two clusters makes the bounding box bigger, which may allow merging with more clusters.
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (size_t j = 0; j < clusters.size(); j++)
+            {
+                const auto bbox = box_union(clusters[j].box, current.box);
+                const int64_t total = clusters[j].covered + current.covered;
+                if (box_area(bbox) <= max_ratio * total)
+                {
+                    current = {bbox, total};
+                    clusters[j] = clusters.back();
+                    clusters.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+
+        clusters.push_back(current);
+    }
+
+    if ((int)clusters.size() >= nrects)
+    {
+        return;
+    }
+
+    std::vector<pixman_box32_t> boxes;
+    boxes.reserve(clusters.size());
+    for (auto& cluster : clusters)
+    {
+        boxes.push_back(cluster.box);
+    }
+
+    *this = wf::region_t{boxes.data(), (int)boxes.size()};
+}
+
+int wf::region_t::size() const
+{
+    return pixman_region32_n_rects(this->unconst());
+}
+
 pixman_box32_t wf::region_t::get_extents() const
 {
     return *pixman_region32_extents(this->unconst());
@@ -134,6 +264,17 @@ bool wf::region_t::contains_point(const wf::point_t& point) const
         point.x, point.y, NULL);
 }
 
+bool wf::region_t::intersects(const wlr_box& box) const
+{
+    if ((box.width <= 0) || (box.height <= 0))
+    {
+        return false;
+    }
+
+    auto pbox = pixman_box_from_wlr_box(box);
+    return pixman_region32_contains_rectangle(this->unconst(), &pbox) != PIXMAN_REGION_OUT;
+}
+
 bool wf::region_t::contains_pointf(const wf::pointf_t& point) const
 {
     for (auto& box : *this)
@@ -1,10 +1,16 @@
 #include <wayfire/render.hpp>
 #include "core/core-impl.hpp"
+#include "output/frame-profiler.hpp"
 #include "wayfire/dassert.hpp"
 #include "wayfire/nonstd/reverse.hpp"
 #include "wayfire/opengl.hpp"
 #include <wayfire/scene-render.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/trace.hpp>
 #include <drm_fourcc.h>
+#include <algorithm>
+#include <map>
+#include <cmath>
 
 wf::render_buffer_t::render_buffer_t(wlr_buffer *buffer, wf::dimensions_t size)
 {
@@ -12,6 +18,87 @@ wf::render_buffer_t::render_buffer_t(wlr_buffer *buffer, wf::dimensions_t size)
     this->size   = size;
 }
 
+namespace
+{
+struct buffer_owner_usage_t
+{
+    wf::buffer_memory_usage_t usage;
+    // Number of allocations since the owner last freed a buffer.
+    int growth_streak = 0;
+    // live_bytes when the last leak warning was printed.
+    size_t warned_at = 0;
+};
+
+// Owners whose live memory grew with this many allocations in a row are suspected to leak buffers.
+constexpr int LEAK_GROWTH_STREAK = 16;
+// Owners without live buffers are forgotten once there are more owners than this.
+constexpr size_t MAX_IDLE_OWNERS = 256;
+
+std::map<std::string, buffer_owner_usage_t>& get_buffer_owners()
+{
+    // Never destroyed, since buffers may be freed during static destruction.
+    static auto owners = new std::map<std::string, buffer_owner_usage_t>();
+    return *owners;
+}
+
+size_t get_buffer_bytes(wf::dimensions_t size)
+{
+    return (size_t)size.width * size.height * 4;
+}
+
+void track_buffer_allocation(const std::string& owner, size_t bytes)
+{
+    static wf::option_wrapper_t<int> leak_warning{"core/buffer_leak_warning"};
+
+    auto& entry = get_buffer_owners()[owner];
+    auto& usage = entry.usage;
+    usage.owner = owner;
+    usage.live_bytes += bytes;
+    usage.peak_bytes  = std::max(usage.peak_bytes, usage.live_bytes);
+    usage.buffers++;
+    usage.allocations++;
+    entry.growth_streak++;
+
+    const size_t min_leak_bytes = (size_t)std::max(0, (int)leak_warning) << 20;
+    if ((leak_warning >= 0) && (entry.growth_streak >= LEAK_GROWTH_STREAK) &&
+        (usage.live_bytes >= min_leak_bytes) && (usage.live_bytes >= 2 * entry.warned_at))
+    {
+        LOGW("Buffers owned by \"", owner, "\" keep growing: ", usage.buffers, " buffers, ",
+            usage.live_bytes >> 20, " MiB. This may indicate leaked snapshots.");
+        entry.warned_at = usage.live_bytes;
+    }
+}
+
+void track_buffer_free(const std::string& owner, size_t bytes)
+{
+    auto& owners = get_buffer_owners();
+    auto& entry  = owners[owner];
+    entry.usage.live_bytes -= std::min(bytes, entry.usage.live_bytes);
+    entry.usage.buffers   -= std::min<size_t>(1, entry.usage.buffers);
+    entry.growth_streak    = 0;
+
+    // Owners are often specific to a view, so do not keep them around forever.
+    if (owners.size() > MAX_IDLE_OWNERS)
+    {
+        for (auto it = owners.begin(); it != owners.end();)
+        {
+            it = (it->second.usage.buffers == 0) ? owners.erase(it) : std::next(it);
+        }
+    }
+}
+}
+
+std::vector<wf::buffer_memory_usage_t> wf::get_buffer_memory_usage()
+{
+    std::vector<buffer_memory_usage_t> result;
+    for (auto& [_, entry] : get_buffer_owners())
+    {
+        result.push_back(entry.usage);
+    }
+
+    return result;
+}
+
 wf::auxilliary_buffer_t::auxilliary_buffer_t(auxilliary_buffer_t&& other)
 {
     *this = std::move(other);
@@ -24,11 +111,35 @@ wf::auxilliary_buffer_t& wf::auxilliary_buffer_t::operator =(auxilliary_buffer_t
         return *this;
     }
 
+    free();
     this->texture = std::exchange(other.texture, nullptr);
     this->buffer  = std::exchange(other.buffer, {});
+    // The memory is accounted to the owner, so the owner goes with the buffer.
+    this->owner = other.owner;
     return *this;
 }
 
+void wf::auxilliary_buffer_t::set_owner(const std::string& owner)
+{
+    if (owner == this->owner)
+    {
+        return;
+    }
+
+    if (buffer.get_buffer())
+    {
+        track_buffer_free(this->owner, get_buffer_bytes(buffer.get_size()));
+        track_buffer_allocation(owner, get_buffer_bytes(buffer.get_size()));
+    }
+
+    this->owner = owner;
+}
+
+const std::string& wf::auxilliary_buffer_t::get_owner() const
+{
+    return owner;
+}
+
 wf::auxilliary_buffer_t::~auxilliary_buffer_t()
 {
     free();
@@ -163,6 +274,7 @@ wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimension
     }
 
     buffer.size = size;
+    track_buffer_allocation(owner, get_buffer_bytes(size));
     return buffer_reallocation_result_t::REALLOCATED;
 }
 
@@ -177,6 +289,7 @@ void wf::auxilliary_buffer_t::free()
 
     if (buffer.get_buffer())
     {
+        track_buffer_free(owner, get_buffer_bytes(buffer.get_size()));
         wlr_buffer_drop(buffer.get_buffer());
     }
 
@@ -321,15 +434,33 @@ wlr_box wf::render_target_t::framebuffer_box_from_geometry_box(wlr_box box) cons
     return round_fbox_to_containing_box(scaled_fbox);
 }
 
-wf::region_t wf::render_target_t::framebuffer_region_from_geometry_region(const wf::region_t& region) const
+/**
+ * Transform each rectangle of a region and build the union of the results at once, instead of doing one
+ * union operation per rectangle.
+ */
+template<class Transform>
+static wf::region_t transform_region(const wf::region_t& region, Transform&& transform)
 {
-    wf::region_t result;
+    std::vector<pixman_box32_t> boxes;
+    boxes.reserve(region.size());
     for (const auto& rect : region)
     {
-        result |= framebuffer_box_from_geometry_box(wlr_box_from_pixman_box(rect));
+        auto box = transform(wlr_box_from_pixman_box(rect));
+        if ((box.width > 0) && (box.height > 0))
+        {
+            boxes.push_back(pixman_box_from_wlr_box(box));
+        }
     }
 
-    return result;
+    return wf::region_t{boxes.data(), (int)boxes.size()};
+}
+
+wf::region_t wf::render_target_t::framebuffer_region_from_geometry_region(const wf::region_t& region) const
+{
+    return transform_region(region, [&] (const wlr_box& box)
+    {
+        return framebuffer_box_from_geometry_box(box);
+    });
 }
 
 wlr_fbox wf::render_target_t::geometry_fbox_from_framebuffer_box(wlr_fbox fb_box) const
@@ -366,13 +497,45 @@ wlr_box wf::render_target_t::geometry_box_from_framebuffer_box(wlr_box fb_box) c
 
 wf::region_t wf::render_target_t::geometry_region_from_framebuffer_region(const wf::region_t& region) const
 {
-    wf::region_t result;
-    for (const auto& rect : region)
+    return transform_region(region, [&] (const wlr_box& box)
     {
-        result |= geometry_box_from_framebuffer_box(wlr_box_from_pixman_box(rect));
+        return geometry_box_from_framebuffer_box(box);
+    });
+}
+
+namespace
+{
+using instruction_list_t = std::vector<wf::scene::render_instruction_t>;
+
+/**
+ * Only the storage of the instruction lists is kept between render passes, so that it does not have to be
+ * grown again for every pass. The instructions themselves are scheduled anew for every pass and are
+ * destroyed when the list is released. Passes can be nested (for example, when a render instance renders
+ * its children to an auxilliary buffer), so we keep a small pool of lists instead of a single one.
+ */
+std::vector<std::unique_ptr<instruction_list_t>> instruction_storage_pool;
+constexpr size_t MAX_POOLED_INSTRUCTION_STORAGE = 16;
+
+std::unique_ptr<instruction_list_t> acquire_instruction_storage()
+{
+    if (instruction_storage_pool.empty())
+    {
+        return std::make_unique<instruction_list_t>();
     }
 
-    return result;
+    auto list = std::move(instruction_storage_pool.back());
+    instruction_storage_pool.pop_back();
+    return list;
+}
+
+void release_instruction_storage(std::unique_ptr<instruction_list_t> list)
+{
+    list->clear();
+    if (instruction_storage_pool.size() < MAX_POOLED_INSTRUCTION_STORAGE)
+    {
+        instruction_storage_pool.push_back(std::move(list));
+    }
+}
 }
 
 wf::render_pass_t::render_pass_t(const render_pass_params_t& p)
@@ -390,9 +553,45 @@ wf::region_t wf::render_pass_t::run(const wf::render_pass_params_t& params)
     return damage;
 }
 
+static int64_t region_area(const wf::region_t& region)
+{
+    int64_t area = 0;
+    for (const auto& box : region)
+    {
+        area += int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+    }
+
+    return area;
+}
+
+void wf::render_pass_t::expand_damage(wf::region_t& damage)
+{
+    wf::region_t expanded = damage;
+    for (auto& inst : *params.instances)
+    {
+        inst->expand_damage(params.target, expanded);
+    }
+
+    expanded ^= damage;
+    expanded &= params.target.geometry;
+    TRACE_COUNTER(RENDER, "damage-expansion-pixels", region_area(expanded));
+    damage |= expanded;
+}
+
 wf::region_t wf::render_pass_t::run_partial()
 {
+    TRACE_SCOPE(RENDER, "render-pass");
+    // Individual instances and the whole pass are timed only if a frame stall may need to be explained.
+    auto& profiler = frame_profiler_t::get();
+    const bool profile = profiler.is_active();
+    const int64_t pass_start = profile ? wf::get_current_time_us() : 0;
+
     auto accumulated_damage = params.damage;
+    if (params.instances)
+    {
+        expand_damage(accumulated_damage);
+    }
+
     if (params.flags & RPASS_EMIT_SIGNALS)
     {
         // Emit render_pass_begin
@@ -400,19 +599,32 @@ wf::region_t wf::render_pass_t::run_partial()
         wf::get_core().emit(&ev);
     }
 
+    if (params.damage_coalesce_threshold >= 0)
+    {
+        accumulated_damage.coalesce(params.damage_coalesce_threshold);
+    }
+
     wf::region_t swap_damage = accumulated_damage;
 
     // Gather instructions
-    std::vector<wf::scene::render_instruction_t> instructions;
+    auto instruction_list = acquire_instruction_storage();
+    auto& instructions    = *instruction_list;
     if (params.instances)
     {
         for (auto& inst : *params.instances)
         {
+            const int64_t start = profile ? wf::get_current_time_us() : 0;
             inst->schedule_instructions(instructions,
                 params.target, accumulated_damage);
+            if (profile)
+            {
+                profiler.record_instance(inst.get(), "schedule", wf::get_current_time_us() - start);
+            }
         }
     }
 
+    cull_occluded_instructions(instructions);
+
     this->pass = wlr_renderer_begin_buffer_pass(
         params.renderer ?: wf::get_core().renderer,
         params.target.get_buffer(),
@@ -421,6 +633,7 @@ wf::region_t wf::render_pass_t::run_partial()
     if (!pass)
     {
         LOGE("Error: failed to start wlr render pass!");
+        release_instruction_storage(std::move(instruction_list));
         return accumulated_damage;
     }
 
@@ -434,7 +647,13 @@ wf::region_t wf::render_pass_t::run_partial()
     for (auto& instr : wf::reverse(instructions))
     {
         instr.pass = this;
+        const int64_t start = profile ? wf::get_current_time_us() : 0;
         instr.instance->render(instr);
+        if (profile)
+        {
+            profiler.record_instance(instr.instance, "render", wf::get_current_time_us() - start);
+        }
+
         if (params.reference_output)
         {
             instr.instance->presentation_feedback(params.reference_output);
@@ -447,6 +666,12 @@ wf::region_t wf::render_pass_t::run_partial()
         wf::get_core().emit(&end_ev);
     }
 
+    if (profile)
+    {
+        profiler.record_pass(params, instructions.size(), wf::get_current_time_us() - pass_start);
+    }
+
+    release_instruction_storage(std::move(instruction_list));
     return swap_damage;
 }
 
@@ -455,6 +680,64 @@ wf::render_target_t wf::render_pass_t::get_target() const
     return params.target;
 }
 
+uint32_t wf::render_pass_t::get_culled_instructions() const
+{
+    return culled_instructions;
+}
+
+void wf::render_pass_t::cull_occluded_instructions(std::vector<scene::render_instruction_t>& instructions)
+{
+    culled_instructions = 0;
+    const bool has_opaque = std::any_of(instructions.begin(), instructions.end(),
+        [] (const scene::render_instruction_t& instr)
+    {
+        return !instr.opaque.empty();
+    });
+    if (!has_opaque)
+    {
+        return;
+    }
+
+    // Instructions are ordered front-to-back, so each instruction can only be hidden by the instructions
+    // before it. The covered area is tracked in framebuffer coordinates, because instructions may have
+    // differently translated targets.
+    wf::region_t occluded;
+    auto it = std::remove_if(instructions.begin(), instructions.end(), [&] (scene::render_instruction_t& instr)
+    {
+        if (instr.target.get_buffer() != params.target.get_buffer())
+        {
+            return false;
+        }
+
+        if (!occluded.empty())
+        {
+            wf::region_t visible = instr.target.framebuffer_region_from_geometry_region(instr.damage);
+            visible ^= occluded;
+            if (visible.empty())
+            {
+                ++culled_instructions;
+                return true;
+            }
+
+            instr.damage &= instr.target.geometry_region_from_framebuffer_region(visible);
+        }
+
+        // With fractional scales or subbuffers, boxes are rounded outwards when converted to framebuffer
+        // coordinates, so the opaque region could grow by a pixel. Do not use it for occlusion then.
+        const bool exact_target = !instr.target.subbuffer &&
+            (instr.target.scale == std::floor(instr.target.scale));
+        if (exact_target && !instr.opaque.empty())
+        {
+            // Only the parts which are actually repainted by the instruction hide what is behind them.
+            occluded |= instr.target.framebuffer_region_from_geometry_region(instr.opaque & instr.damage);
+        }
+
+        return false;
+    });
+
+    instructions.erase(it, instructions.end());
+}
+
 wlr_renderer*wf::render_pass_t::get_wlr_renderer() const
 {
     return params.renderer;
@@ -583,6 +866,7 @@ wf::render_pass_t& wf::render_pass_t::operator =(render_pass_t&& other)
     this->pass   = other.pass;
     other.pass   = NULL;
     this->params = other.params;
+    this->culled_instructions = other.culled_instructions;
     return *this;
 }
 
@@ -0,0 +1,231 @@
+#include <wayfire/trace.hpp>
+#include <wayfire/util.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <unistd.h>
+
+namespace
+{
+/* Number of events kept in the ring buffer. */
+constexpr uint64_t BUFFER_SIZE = 1 << 17;
+
+struct trace_event_t
+{
+    /* Index of the event plus one once it is fully written, 0 while it is being written. */
+    std::atomic<uint64_t> seq{0};
+    int64_t timestamp;
+    const char *name;
+    /* Counter value or the id of an asynchronous event */
+    int64_t value;
+    uint32_t thread;
+    wf::log::logging_category category;
+    /* Chrome trace-event phase: B, E, b, e, n or C */
+    char phase;
+};
+
+struct trace_buffer_t
+{
+    std::unique_ptr<trace_event_t[]> events = std::make_unique<trace_event_t[]>(BUFFER_SIZE);
+    /* Index of the next event to be written. */
+    std::atomic<uint64_t> head{0};
+    /* Index of the first event which has not been flushed yet. */
+    uint64_t tail = 0;
+};
+
+std::atomic<trace_buffer_t*> buffer{nullptr};
+std::string default_path;
+
+uint32_t get_thread_index()
+{
+    static std::atomic<uint32_t> next_thread{1};
+    thread_local uint32_t index = next_thread++;
+    return index;
+}
+
+void record(char phase, wf::log::logging_category category, const char *name, int64_t value)
+{
+    auto buf = buffer.load(std::memory_order_acquire);
+    if (!buf)
+    {
+        return;
+    }
+
+    const uint64_t idx = buf->head.fetch_add(1, std::memory_order_relaxed);
+    auto& ev = buf->events[idx % BUFFER_SIZE];
+    ev.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ev.timestamp = wf::get_current_time_us();
+    ev.name     = name;
+    ev.value    = value;
+    ev.thread   = get_thread_index();
+    ev.category = category;
+    ev.phase    = phase;
+    ev.seq.store(idx + 1, std::memory_order_release);
+}
+
+void write_json_string(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (; *str; ++str)
+    {
+        const unsigned char c = *str;
+        if ((c == '"') || (c == '\\'))
+        {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        } else
+        {
+            fputc(c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+}
+
+std::atomic<bool> wf::trace::enabled{false};
+
+void wf::trace::set_enabled(bool enable)
+{
+    if (enable && !buffer.load())
+    {
+        buffer.store(new trace_buffer_t, std::memory_order_release);
+    }
+
+    enabled.store(enable);
+    LOGI("Tracing ", enable ? "enabled" : "disabled");
+}
+
+const char *wf::trace::intern(const std::string& name)
+{
+    static std::mutex mutex;
+    static std::unordered_set<std::string> names;
+    std::lock_guard lock{mutex};
+    return names.insert(name).first->c_str();
+}
+
+void wf::trace::begin(wf::log::logging_category category, const char *name)
+{
+    record('B', category, name, 0);
+}
+
+void wf::trace::end(wf::log::logging_category category, const char *name)
+{
+    record('E', category, name, 0);
+}
+
+void wf::trace::async_begin(wf::log::logging_category category, const char *name, uint64_t id)
+{
+    record('b', category, name, id);
+}
+
+void wf::trace::async_end(wf::log::logging_category category, const char *name, uint64_t id)
+{
+    record('e', category, name, id);
+}
+
+void wf::trace::async_instant(wf::log::logging_category category, const char *name, uint64_t id)
+{
+    record('n', category, name, id);
+}
+
+void wf::trace::counter(wf::log::logging_category category, const char *name, int64_t value)
+{
+    record('C', category, name, value);
+}
+
+int64_t wf::trace::flush(const std::string& path)
+{
+    auto buf = buffer.load(std::memory_order_acquire);
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        LOGE("Failed to open trace file ", path);
+        return -1;
+    }
+
+    const uint64_t head  = buf ? buf->head.load(std::memory_order_acquire) : 0;
+    const uint64_t first = buf ? std::max(buf->tail, head > BUFFER_SIZE ? head - BUFFER_SIZE : 0) : 0;
+    const int pid = getpid();
+
+    int64_t written = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (uint64_t idx = first; idx < head; idx++)
+    {
+        auto& ev = buf->events[idx % BUFFER_SIZE];
+        if (ev.seq.load(std::memory_order_acquire) != idx + 1)
+        {
+            // Still being written, or already overwritten by a newer event.
+            continue;
+        }
+
+        // Copy the event and check that it was not overwritten in the meantime.
+        const int64_t timestamp = ev.timestamp;
+        const char *name  = ev.name;
+        const int64_t value = ev.value;
+        const uint32_t thread = ev.thread;
+        const auto category   = ev.category;
+        const char phase = ev.phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ev.seq.load(std::memory_order_relaxed) != idx + 1)
+        {
+            continue;
+        }
+
+        fprintf(file, "%s\n{\"name\":", written ? "," : "");
+        write_json_string(file, name);
+        fprintf(file, ",\"cat\":\"%.*s\",\"ph\":\"%c\",\"ts\":%ld,\"pid\":%d,\"tid\":%u",
+            (int)wf::log::get_category_name(category).size(), wf::log::get_category_name(category).data(),
+            phase, (long)timestamp, pid, thread);
+        if (phase == 'C')
+        {
+            fprintf(file, ",\"args\":{\"value\":%ld}", (long)value);
+        } else if ((phase == 'b') || (phase == 'e') || (phase == 'n'))
+        {
+            fprintf(file, ",\"id\":\"0x%lx\"", (unsigned long)value);
+        }
+
+        fprintf(file, "}");
+        ++written;
+    }
+
+    fprintf(file, "\n]}\n");
+    const bool ok = !ferror(file);
+    fclose(file);
+    if (!ok)
+    {
+        LOGE("Failed to write trace file ", path);
+        return -1;
+    }
+
+    if (buf)
+    {
+        buf->tail = head;
+    }
+
+    LOGI("Wrote ", written, " trace events to ", path);
+    return written;
+}
+
+std::string wf::trace::get_default_path()
+{
+    if (!default_path.empty())
+    {
+        return default_path;
+    }
+
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    return std::string(dir ? dir : "/tmp") + "/wayfire-trace-" + std::to_string(getpid()) + ".json";
+}
+
+void wf::trace::set_default_path(const std::string& path)
+{
+    default_path = path;
+}
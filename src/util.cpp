@@ -12,6 +12,11 @@ int64_t wf::timespec_to_msec(const timespec& ts)
     return ts.tv_sec * 1000ll + ts.tv_nsec / 1000000ll;
 }
 
+int64_t wf::timespec_to_usec(const timespec& ts)
+{
+    return ts.tv_sec * 1000'000ll + ts.tv_nsec / 1000ll;
+}
+
 int64_t wf::get_current_time()
 {
     timespec ts;
@@ -20,6 +25,14 @@ int64_t wf::get_current_time()
     return wf::timespec_to_msec(ts);
 }
 
+int64_t wf::get_current_time_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return wf::timespec_to_usec(ts);
+}
+
 static void handle_idle_listener(void *data)
 {
     auto call = (wf::wl_idle_call*)(data);
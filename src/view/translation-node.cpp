@@ -95,8 +95,7 @@ void wf::scene::translation_node_instance_t::schedule_instructions(
     std::vector<wf::scene::render_instruction_t>& instructions,
     const wf::render_target_t& target, wf::region_t& damage)
 {
-    wf::region_t our_damage = damage & self->get_bounding_box();
-    if (!our_damage.empty())
+    if (damage.intersects(self->get_bounding_box()))
     {
         wf::point_t offset = self->get_offset();
         damage += -offset;
@@ -133,3 +132,16 @@ void wf::scene::translation_node_instance_t::compute_visibility(wf::output_t *ou
 {
     compute_visibility_from_list(children, output, visible, self->get_offset());
 }
+
+void wf::scene::translation_node_instance_t::expand_damage(const wf::render_target_t& target,
+    wf::region_t& damage)
+{
+    // Damage just outside of the node can still affect it, e.g. the blurred background of a view, so the
+    // children always get to expand the damage.
+    expand_damage_from_list(children, target, damage, self->get_offset());
+}
+
+std::string wf::scene::translation_node_instance_t::stringify() const
+{
+    return self->stringify();
+}
@@ -313,6 +313,10 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             {
                 pixman_region32_subtract(damage.to_pixman(), damage.to_pixman(),
                     &self->surface->opaque_region);
+                if (self->current_state.current_buffer)
+                {
+                    instructions.back().opaque = wf::region_t{&self->surface->opaque_region};
+                }
             }
         }
     }
@@ -379,6 +383,11 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
         }
     }
 
+    std::string stringify() const override
+    {
+        return self->stringify();
+    }
+
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
         auto our_box = self->get_bounding_box();
@@ -0,0 +1,108 @@
+#include "../../src/output/paint-order.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <vector>
+
+// A simulated headless output which became ready to paint at time 0.
+struct simulated_output_t
+{
+    // When the output's next vblank happens, in microseconds.
+    int64_t vblank;
+    // How long it takes to paint the output, in microseconds. The render manager uses a moving average of
+    // the previous paint times as the estimate, which is assumed to be accurate here.
+    int64_t paint_time;
+};
+
+static std::vector<wf::paint_order_queue_t::pending_paint_t> make_paints(
+    const std::vector<simulated_output_t>& outputs, std::vector<int>& painted)
+{
+    std::vector<wf::paint_order_queue_t::pending_paint_t> paints;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        paints.push_back({&outputs[i], outputs[i].vblank - outputs[i].paint_time,
+            [&painted, i] () { painted.push_back(i); }
+        });
+    }
+
+    return paints;
+}
+
+// Paint the outputs one after another in the order of @paints, and count how many miss their vblank.
+static int count_missed_vblanks(const std::vector<simulated_output_t>& outputs,
+    const std::vector<wf::paint_order_queue_t::pending_paint_t>& paints)
+{
+    int64_t now = 0;
+    int missed  = 0;
+    for (auto& paint : paints)
+    {
+        auto output = (const simulated_output_t*)paint.key;
+        now += output->paint_time;
+        missed += (now > output->vblank);
+    }
+
+    return missed;
+}
+
+static void check_order(const std::vector<simulated_output_t>& outputs, std::vector<int> expected,
+    int missed_arrival, int missed_deadline)
+{
+    std::vector<int> painted;
+    auto paints = make_paints(outputs, painted);
+    REQUIRE(count_missed_vblanks(outputs, paints) == missed_arrival);
+
+    wf::paint_order_queue_t::sort_by_deadline(paints, 0);
+    REQUIRE(count_missed_vblanks(outputs, paints) == missed_deadline);
+
+    for (auto& paint : paints)
+    {
+        paint.paint();
+    }
+
+    REQUIRE(painted == expected);
+}
+
+TEST_CASE("An output which misses its vblank anyway is painted last")
+{
+    // Three 60Hz outputs whose page flips arrive together, the first one with expensive effects.
+    std::vector<simulated_output_t> outputs = {
+        {16666, 20000},
+        {16666, 4000},
+        {16666, 4000},
+    };
+
+    check_order(outputs, {1, 2, 0}, 3, 1);
+}
+
+TEST_CASE("Outputs with an earlier deadline are painted first")
+{
+    // A 60Hz output and a 144Hz output whose page flips arrive together.
+    std::vector<simulated_output_t> outputs = {
+        {16666, 9000},
+        {6944, 3000},
+    };
+
+    check_order(outputs, {1, 0}, 1, 0);
+}
+
+TEST_CASE("Outputs with the same deadline keep their arrival order")
+{
+    std::vector<simulated_output_t> outputs = {
+        {16666, 3000},
+        {16666, 3000},
+        {16666, 3000},
+    };
+
+    check_order(outputs, {0, 1, 2}, 0, 0);
+}
+
+TEST_CASE("Among late outputs, the least late one is painted first")
+{
+    std::vector<simulated_output_t> outputs = {
+        {16666, 30000},
+        {16666, 20000},
+        {16666, 2000},
+    };
+
+    check_order(outputs, {2, 1, 0}, 3, 2);
+}
@@ -0,0 +1,182 @@
+#include "wayfire/thread-pool.hpp"
+#include <wayland-server-core.h>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Dispatch the event loop until @condition holds, or until a timeout.
+template<class Condition>
+static bool dispatch_until(wl_event_loop *loop, Condition condition)
+{
+    for (int i = 0; i < 500 && !condition(); i++)
+    {
+        wl_event_loop_dispatch(loop, 10);
+    }
+
+    return condition();
+}
+
+TEST_CASE("Tasks run on workers and complete on the event loop")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 4};
+        REQUIRE(pool.get_num_workers() == 4);
+
+        const auto main_thread = std::this_thread::get_id();
+        std::atomic<int> ran_on_main{0};
+        int completed = 0;
+        bool completed_off_main = false;
+
+        std::vector<wf::task_handle_t> handles;
+        for (int i = 0; i < 32; i++)
+        {
+            handles.push_back(pool.submit([&] ()
+            {
+                ran_on_main += (std::this_thread::get_id() == main_thread);
+            }, [&] ()
+            {
+                completed_off_main |= (std::this_thread::get_id() != main_thread);
+                ++completed;
+            }));
+        }
+
+        REQUIRE(dispatch_until(loop, [&] { return completed == 32; }));
+        REQUIRE(ran_on_main == 0);
+        REQUIRE(!completed_off_main);
+        for (auto& handle : handles)
+        {
+            REQUIRE(!handle.is_pending());
+        }
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+TEST_CASE("Results are passed to the completion callback")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 2};
+        int result = 0;
+        auto handle = pool.submit([] () { return 6 * 7; }, [&] (int value) { result = value; });
+        REQUIRE(handle.is_pending());
+        REQUIRE(dispatch_until(loop, [&] { return result != 0; }));
+        REQUIRE(result == 42);
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+TEST_CASE("Destroying the handle cancels the task")
+{
+    auto loop = wl_event_loop_create();
+    {
+        wf::thread_pool_t pool{loop, 1};
+        std::atomic<bool> release{false};
+        std::atomic<bool> started{false};
+        std::atomic<bool> finished{false};
+        bool blocker_done = false;
+
+        // Keep the only worker busy, so that the second task stays queued.
+        auto blocker = pool.submit([&] ()
+        {
+            started = true;
+            while (!release)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            finished = true;
+        }, [&] () { blocker_done = true; });
+
+        bool queued_ran  = false;
+        bool queued_done = false;
+        {
+            auto queued = pool.submit([&] () { queued_ran = true; }, [&] () { queued_done = true; });
+            REQUIRE(queued.is_pending());
+        }
+
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        // Cancelling a running task waits for it to finish, but does not deliver its completion.
+        std::thread releaser{[&] ()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                release = true;
+            }
+        };
+        blocker.cancel();
+        REQUIRE(finished);
+        REQUIRE(!blocker.is_pending());
+        releaser.join();
+
+        // Wait for an unrelated task, after which the worker has seen the cancelled task.
+        bool last_done = false;
+        auto last = pool.submit([] () {}, [&] () { last_done = true; });
+        REQUIRE(dispatch_until(loop, [&] { return last_done; }));
+        REQUIRE(!queued_ran);
+        REQUIRE(!queued_done);
+        REQUIRE(!blocker_done);
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+TEST_CASE("Destroying the pool cancels queued tasks")
+{
+    auto loop = wl_event_loop_create();
+    std::atomic<bool> release{false};
+    std::atomic<bool> started{false};
+    std::atomic<int> queued_ran{0};
+    std::vector<wf::task_handle_t> handles;
+    std::thread releaser;
+    {
+        wf::thread_pool_t pool{loop, 1};
+
+        // Keep the only worker busy, so that the other tasks stay queued.
+        handles.push_back(pool.submit([&] ()
+        {
+            started = true;
+            while (!release)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }, [] () {}));
+
+        for (int i = 0; i < 8; i++)
+        {
+            handles.push_back(pool.submit([&] () { ++queued_ran; }, [] () {}));
+        }
+
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        // The pool waits for the running task when it is destroyed.
+        releaser = std::thread{[&] ()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                release = true;
+            }
+        };
+    }
+
+    releaser.join();
+    REQUIRE(queued_ran == 0);
+    for (auto& handle : handles)
+    {
+        REQUIRE(!handle.is_pending());
+    }
+
+    handles.clear();
+    wl_event_loop_destroy(loop);
+}
@@ -0,0 +1,97 @@
+#include <wayfire/region.hpp>
+#include <chrono>
+#include <iostream>
+#include <functional>
+#include <string>
+
+/**
+ * Microbenchmarks for the region operations on the damage tracking/rendering path.
+ * Run with `meson test --benchmark`.
+ */
+static void bench(const std::string& name, int iterations, const std::function<void()>& fn)
+{
+    // Warm up caches and the allocator
+    for (int i = 0; i < iterations / 10; i++)
+    {
+        fn();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns  = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    std::cout << name << ": " << (ns / iterations) << " ns/iteration" << std::endl;
+}
+
+static wf::region_t make_terminal_damage(int cells)
+{
+    wf::region_t region;
+    for (int i = 0; i < cells; i++)
+    {
+        region |= wlr_box{(i % 80) * 9, (i / 80) * 18 + (i % 3), 8, 16};
+    }
+
+    return region;
+}
+
+int main()
+{
+    const wlr_box box{100, 100, 640, 480};
+    const wf::region_t single{box};
+    const auto fragmented = make_terminal_damage(400);
+    std::cout << "Fragmented region has " << fragmented.size() << " rectangles" << std::endl;
+
+    bench("single box: copy", 1'000'000, [&] ()
+    {
+        wf::region_t copy = single;
+        (void)copy;
+    });
+
+    bench("single box: intersect box", 1'000'000, [&] ()
+    {
+        auto result = single & wlr_box{200, 200, 1000, 1000};
+        (void)result;
+    });
+
+    bench("single box: expand_edges", 1'000'000, [&] ()
+    {
+        wf::region_t copy = single;
+        copy.expand_edges(16);
+    });
+
+    bench("fragmented: expand_edges", 10'000, [&] ()
+    {
+        wf::region_t copy = fragmented;
+        copy.expand_edges(16);
+    });
+
+    bench("fragmented: coalesce(0.25)", 10'000, [&] ()
+    {
+        wf::region_t copy = fragmented;
+        copy.coalesce(0.25);
+    });
+
+    bench("fragmented: union of boxes", 10'000, [&] ()
+    {
+        wf::region_t result;
+        for (auto& rect : fragmented)
+        {
+            result |= wlr_box_from_pixman_box(rect);
+        }
+    });
+
+    bench("fragmented: region from boxes", 10'000, [&] ()
+    {
+        wf::region_t result{fragmented.begin(), fragmented.size()};
+        (void)result;
+    });
+
+    wf::region_t coalesced = fragmented;
+    coalesced.coalesce(0.25);
+    std::cout << "Coalesced region has " << coalesced.size() << " rectangles" << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/region.hpp>
+
+static int64_t region_area(const wf::region_t& region)
+{
+    int64_t area = 0;
+    for (auto& box : region)
+    {
+        area += int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+    }
+
+    return area;
+}
+
+static bool region_contains(const wf::region_t& big, const wf::region_t& small)
+{
+    return (small ^ big).empty();
+}
+
+TEST_CASE("Region from boxes")
+{
+    pixman_box32_t boxes[] = {
+        {0, 0, 10, 10},
+        {5, 5, 15, 15},
+        {100, 100, 110, 110},
+    };
+
+    wf::region_t region{boxes, 3};
+    REQUIRE_EQ(region_area(region), 100 + 100 - 25 + 100);
+
+    wf::region_t single{boxes, 1};
+    REQUIRE_EQ(single.size(), 1);
+    REQUIRE_EQ(region_area(single), 100);
+
+    wf::region_t empty{boxes, 0};
+    REQUIRE(empty.empty());
+}
+
+TEST_CASE("Expand single-box region")
+{
+    wf::region_t region{wlr_box{10, 10, 10, 10}};
+    region.expand_edges(5);
+    REQUIRE_EQ(region.size(), 1);
+    auto extents = region.get_extents();
+    REQUIRE_EQ(extents.x1, 5);
+    REQUIRE_EQ(extents.y1, 5);
+    REQUIRE_EQ(extents.x2, 25);
+    REQUIRE_EQ(extents.y2, 25);
+
+    region.expand_edges(-20);
+    REQUIRE(region.empty());
+}
+
+TEST_CASE("Coalesce dense region into extents")
+{
+    wf::region_t region;
+    // A grid of 10x10 cells with 1px gaps, as produced by a terminal.
+    for (int i = 0; i < 10; i++)
+    {
+        for (int j = 0; j < 10; j++)
+        {
+            region |= wlr_box{i * 11, j * 11, 10, 10};
+        }
+    }
+
+    auto original = region;
+    REQUIRE(region.size() > 1);
+    region.coalesce(0.25);
+    REQUIRE_EQ(region.size(), 1);
+    REQUIRE(region_contains(region, original));
+}
+
+TEST_CASE("Coalesce keeps distant rectangles apart")
+{
+    wf::region_t region;
+    region |= wlr_box{0, 0, 10, 10};
+    region |= wlr_box{0, 12, 10, 10};
+    region |= wlr_box{1000, 1000, 10, 10};
+
+    auto original = region;
+    region.coalesce(0.25);
+    REQUIRE(region_contains(region, original));
+    REQUIRE_EQ(region.size(), 2);
+    REQUIRE(region_area(region) <= 1.25 * region_area(original) + 100);
+}
+
+TEST_CASE("Coalesce with zero overdraw is lossless")
+{
+    wf::region_t region;
+    region |= wlr_box{0, 0, 10, 10};
+    region |= wlr_box{50, 50, 10, 10};
+
+    auto original = region;
+    region.coalesce(0.0);
+    REQUIRE_EQ(region_area(region), region_area(original));
+    REQUIRE(region_contains(region, original));
+}